@@ -17,17 +17,42 @@ DEFINES += QT_DEPRECATED_WARNINGS
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
+    apicall.cpp \
     authmanager.cpp \
+    cancellation.cpp \
+    jsonfields.cpp \
+    jsonitemstream.cpp \
     main.cpp \
     mainwindow.cpp \
+    metrics.cpp \
+    metricsserver.cpp \
     oauthform.cpp \
-    tasklist.cpp
+    refreshscheduler.cpp \
+    smartviewmodel.cpp \
+    taskcache.cpp \
+    taskexporter.cpp \
+    taskindex.cpp \
+    tasklist.cpp \
+    tasksapi.cpp
 
 HEADERS += \
+    apicall.h \
     authmanager.h \
+    cancellation.h \
+    jsonfields.h \
+    jsonitemstream.h \
     mainwindow.h \
+    metrics.h \
+    metricsserver.h \
     oauthform.h \
-    tasklist.h
+    refreshscheduler.h \
+    smartviewmodel.h \
+    taskcache.h \
+    taskexporter.h \
+    taskindex.h \
+    tasklist.h \
+    tasksapi.h \
+    tasksnapshot.h
 
 FORMS += \
     mainwindow.ui \
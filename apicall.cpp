@@ -0,0 +1,77 @@
+#include "apicall.h"
+
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QtNetworkAuth/QOAuth2AuthorizationCodeFlow>
+
+#include "jsonitemstream.h"
+
+struct ApiCall::State
+{
+    explicit State(const CancellationToken & token):
+        token(token),
+        stream([this](const QByteArray & item) { onItem(item); })
+    {
+    }
+
+    CancellationToken token;
+    int registration = -1;
+    ItemHandler onItem;
+    Continuation then;
+    JsonItemStream stream;
+};
+
+ApiCall::ApiCall(QNetworkReply *reply, const CancellationToken &token):
+    mState(std::make_shared<State>(token))
+{
+    // The connections share the state, so it lives exactly as long as the reply
+    auto state = mState;
+    QObject::connect(reply, &QNetworkReply::readyRead, reply, [reply, state]() {
+        // Without an item handler the body is left to the continuation
+        if (state->onItem && !state->token.isCancelled() && !state->stream.feed(reply->readAll()))
+        {
+            reply->abort();
+        }
+    });
+    QObject::connect(reply, &QNetworkReply::finished, reply, [reply, state]() {
+        reply->deleteLater();
+        state->token.unregister(state->registration);
+        if (state->token.isCancelled() || !state->then)
+        {
+            return;
+        }
+        // A streamed body must also be complete; a truncated one parses
+        // without error up to where it stops
+        const bool ok = reply->error() == QNetworkReply::NoError
+                && (!state->onItem || (state->stream.feed(reply->readAll()) && state->stream.atEnd()));
+        state->then({reply, ok, [state](const QString & name) { return state->stream.field(name); }});
+    });
+    // Last, so that a token which already fired aborts a fully wired reply
+    mState->registration = token.onCancel([reply]() {
+        reply->abort();
+    });
+}
+
+ApiCall ApiCall::get(QOAuth2AuthorizationCodeFlow &flow, const QUrl &url, const CancellationToken &token)
+{
+    return ApiCall(flow.get(url), token);
+}
+
+ApiCall ApiCall::send(QOAuth2AuthorizationCodeFlow &flow, QNetworkRequest request,
+                      const CancellationToken &token, const Sender &send)
+{
+    request.setRawHeader("Authorization", "Bearer " + flow.token().toUtf8());
+    return ApiCall(send(*flow.networkAccessManager(), request), token);
+}
+
+ApiCall &ApiCall::onItem(ItemHandler handler)
+{
+    mState->onItem = std::move(handler);
+    return *this;
+}
+
+ApiCall &ApiCall::then(Continuation continuation)
+{
+    mState->then = std::move(continuation);
+    return *this;
+}
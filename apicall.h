@@ -0,0 +1,59 @@
+#ifndef APICALL_H
+#define APICALL_H
+
+#include <functional>
+#include <memory>
+
+#include <QNetworkRequest>
+#include <QString>
+#include <QUrl>
+
+#include "cancellation.h"
+
+class QNetworkAccessManager;
+class QNetworkReply;
+class QOAuth2AuthorizationCodeFlow;
+
+// What an ApiCall delivers once its reply has finished
+struct ApiResponse
+{
+    // Valid for the duration of the continuation. The body is left unread
+    // unless items were streamed.
+    QNetworkReply * reply = nullptr;
+    // No network error and, for streamed bodies, well-formed JSON
+    bool ok = false;
+    // Top-level string members of a streamed body, e.g. "nextPageToken"
+    std::function<QString(const QString & name)> field;
+};
+
+// Future for one Tasks API request. Continuations are attached right after
+// the call is made and run on the calling thread. Once the token fires the
+// transfer is aborted on the spot and no continuation runs any more, so
+// requests of a closed view or a removed list neither keep downloading nor
+// touch their freed owner.
+class ApiCall
+{
+public:
+    using ItemHandler = std::function<void(const QByteArray & item)>;
+    using Continuation = std::function<void(const ApiResponse & response)>;
+    using Sender = std::function<QNetworkReply*(QNetworkAccessManager & manager, const QNetworkRequest & request)>;
+
+    // GET with the flow's authorization
+    static ApiCall get(QOAuth2AuthorizationCodeFlow & flow, const QUrl & url, const CancellationToken & token);
+    // request carrying the flow's bearer token, sent by send on the flow's manager
+    static ApiCall send(QOAuth2AuthorizationCodeFlow & flow, QNetworkRequest request,
+                        const CancellationToken & token, const Sender & send);
+
+    // Each object of the body's "items" array as soon as it is complete
+    ApiCall & onItem(ItemHandler handler);
+    ApiCall & then(Continuation continuation);
+
+private:
+    struct State;
+
+    ApiCall(QNetworkReply * reply, const CancellationToken & token);
+
+    std::shared_ptr<State> mState;
+};
+
+#endif // APICALL_H
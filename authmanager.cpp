@@ -8,13 +8,19 @@
 
 #include <QDebug>
 
+#include "tasksapi.h"
+
+constexpr const char * tasks_scope = "https://www.googleapis.com/auth/tasks";
+
 AuthManager::AuthManager(): mFlow(std::make_shared<QOAuth2AuthorizationCodeFlow>())
 {
     mFlow = std::make_shared<QOAuth2AuthorizationCodeFlow>();
     mFlow->setAuthorizationUrl(QUrl("https://accounts.google.com/o/oauth2/auth"));
-    mFlow->setScope("https://www.googleapis.com/auth/tasks.readonly");
+    mFlow->setScope(tasks_scope);
     mFlow->setAccessTokenUrl(QUrl("https://oauth2.googleapis.com/token"));
     mFlow->setReplyHandler(new QOAuthHttpServerReplyHandler(8080, mFlow.get()));
+    auto networkAccessManager = new ApiNetworkAccessManager(mFlow.get());
+    mFlow->setNetworkAccessManager(networkAccessManager);
     mFlow->setModifyParametersFunction([ptr = mFlow](QAbstractOAuth::Stage stage,
                                              QVariantMap* parameters)
     {
@@ -35,13 +41,24 @@ AuthManager::AuthManager(): mFlow(std::make_shared<QOAuth2AuthorizationCodeFlow>
             // Google requires CID and CS to be in query params. Bad request reply otherwise
             parameters->insert("client_id", ptr->clientIdentifier());
             parameters->insert("client_secret", ptr->clientIdentifierSharedKey());
+            Metrics::instance().increment(metric_token_refreshes);
         }
     });
+    mGrantedConnection = QObject::connect(mFlow.get(), &QAbstractOAuth::granted, [this]() {
+        mGrantedScope = mFlow->scope();
+    });
     tryInitFromCache();
+    if (mInitStatus == InitFromCacheStatus::Success)
+    {
+        // The handshake overlaps with building the UI instead of delaying the first request
+        networkAccessManager->warmUp();
+    }
 }
 
 AuthManager::~AuthManager()
 {
+    // The flow is shared and may outlive the manager
+    QObject::disconnect(mGrantedConnection);
     if (mFlow->clientIdentifier().length())
     {
     auto filename = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation).append("/udata");
@@ -50,6 +67,7 @@ AuthManager::~AuthManager()
     object["csk"] = mFlow->clientIdentifierSharedKey();
     object["token"] = mFlow->token();
     object["rtoken"] = mFlow->refreshToken();
+    object["scope"] = mGrantedScope;
 
     if (QFile cacheFile(filename); cacheFile.open(QIODevice::WriteOnly | QIODevice::Text))
     {
@@ -101,6 +119,14 @@ void AuthManager::tryInitFromCache()
             QJsonObject object = doc.object();
             mFlow->setClientIdentifier(object["cid"].toString());
             mFlow->setClientIdentifierSharedKey(object["csk"].toString());
+            // Tokens cached before writes existed were granted read-only
+            // access; every edit would be refused, so ask for consent again
+            if (!object["scope"].toString().split(' ').contains(tasks_scope))
+            {
+                mInitStatus = InitFromCacheStatus::NoToken;
+                return;
+            }
+            mGrantedScope = object["scope"].toString();
             mFlow->setToken(object["token"].toString());
             mFlow->setRefreshToken(object["rtoken"].toString());
             mInitStatus = InitFromCacheStatus::Success;
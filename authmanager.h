@@ -30,6 +30,10 @@ private:
 
     InitFromCacheStatus mInitStatus;
 
+    // Scope the cached token was granted for; stored next to it
+    QString mGrantedScope;
+    QMetaObject::Connection mGrantedConnection;
+
     void tryInitFromCache();
 };
 
@@ -0,0 +1,26 @@
+QT += testlib network
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TEMPLATE = app
+TARGET = tst_connection
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+APP_DIR = $$PWD/../..
+INCLUDEPATH += $$APP_DIR
+
+SOURCES += \
+    tst_connection.cpp \
+    $$APP_DIR/metrics.cpp \
+    $$APP_DIR/tasksapi.cpp
+
+HEADERS += \
+    $$APP_DIR/metrics.h \
+    $$APP_DIR/tasksapi.h
+
+# Self-signed for localhost and 127.0.0.1, only ever trusted by this benchmark
+DISTFILES += \
+    standin.crt \
+    standin.key
@@ -0,0 +1,263 @@
+#include <algorithm>
+#include <memory>
+
+#include <QtTest>
+#include <QElapsedTimer>
+#include <QNetworkReply>
+#include <QSslCertificate>
+#include <QSslConfiguration>
+#include <QSslKey>
+#include <QSslSocket>
+#include <QTcpServer>
+
+#include "tasksapi.h"
+
+// Fresh managers per round, so each one starts without connections or TLS sessions
+constexpr int rounds = 25;
+constexpr int timeout = 5000;
+
+constexpr const char * response_body = "{\"kind\":\"tasks#taskLists\",\"etag\":\"\\\"standin\\\"\",\"items\":[]}";
+
+// Local HTTPS stand-in for tasks.googleapis.com. Answers every request with
+// a fixed collection over keep-alive connections and counts handshakes. It
+// only speaks HTTP/1.1; offering h2 is good for checking ALPN, not requests.
+class StandInServer : public QTcpServer
+{
+    Q_OBJECT
+
+public:
+    StandInServer(const QSslCertificate & certificate, const QSslKey & key,
+                  const QList<QByteArray> & protocols = {QSslConfiguration::NextProtocolHttp1_1})
+    {
+        mConfiguration = QSslConfiguration::defaultConfiguration();
+        mConfiguration.setLocalCertificate(certificate);
+        mConfiguration.setPrivateKey(key);
+        mConfiguration.setAllowedNextProtocols(protocols);
+    }
+
+    int handshakes() const
+    {
+        return mHandshakes;
+    }
+
+    // ALPN result of the last handshake
+    QByteArray negotiatedProtocol() const
+    {
+        return mNegotiatedProtocol;
+    }
+
+signals:
+    void handshakeCompleted();
+
+protected:
+    void incomingConnection(qintptr socketDescriptor) override
+    {
+        auto socket = new QSslSocket(this);
+        if (!socket->setSocketDescriptor(socketDescriptor))
+        {
+            delete socket;
+            return;
+        }
+        socket->setSslConfiguration(mConfiguration);
+        connect(socket, &QSslSocket::encrypted, this, [this, socket]() {
+            ++mHandshakes;
+            mNegotiatedProtocol = socket->sslConfiguration().nextNegotiatedProtocol();
+            emit handshakeCompleted();
+        });
+        connect(socket, &QSslSocket::readyRead, this, [socket]() {
+            respond(socket);
+        });
+        connect(socket, &QSslSocket::disconnected, socket, &QObject::deleteLater);
+        socket->startServerEncryption();
+    }
+
+private:
+    static void respond(QSslSocket * socket)
+    {
+        // Requests carry no body, each ends with its header block
+        for (int end; (end = socket->peek(socket->bytesAvailable()).indexOf("\r\n\r\n")) >= 0;)
+        {
+            socket->read(end + 4);
+            const QByteArray body(response_body);
+            socket->write("HTTP/1.1 200 OK\r\n"
+                          "Content-Type: application/json; charset=UTF-8\r\n"
+                          "Content-Length: " + QByteArray::number(body.size()) + "\r\n"
+                          "\r\n" + body);
+        }
+    }
+
+    QSslConfiguration mConfiguration;
+    int mHandshakes = 0;
+    QByteArray mNegotiatedProtocol;
+};
+
+class ConnectionBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void firstRequest_data();
+    void firstRequest();
+    void hosts_data();
+    void hosts();
+    void alpn();
+
+private:
+    QNetworkRequest request(const QString & host, const QString & path) const;
+    static qreal median(QVector<qreal> samples);
+
+    std::unique_ptr<StandInServer> mServer;
+    QSslCertificate mCertificate;
+    QSslKey mKey;
+};
+
+void ConnectionBenchmark::initTestCase()
+{
+    if (!QSslSocket::supportsSsl())
+    {
+        QSKIP("No TLS backend available");
+    }
+
+    QFile certificate(QFINDTESTDATA("standin.crt"));
+    QFile key(QFINDTESTDATA("standin.key"));
+    QVERIFY(certificate.open(QIODevice::ReadOnly));
+    QVERIFY(key.open(QIODevice::ReadOnly));
+    mCertificate = QSslCertificate(&certificate);
+    QVERIFY(!mCertificate.isNull());
+
+    mKey = QSslKey(&key, QSsl::Rsa);
+    QVERIFY(!mKey.isNull());
+    mServer = std::make_unique<StandInServer>(mCertificate, mKey);
+    QVERIFY(mServer->listen(QHostAddress::LocalHost));
+
+    // ApiNetworkAccessManager starts from the default configuration; trust
+    // the stand-in instead of public CAs
+    auto configuration = QSslConfiguration::defaultConfiguration();
+    configuration.setCaCertificates({mCertificate});
+    QSslConfiguration::setDefaultConfiguration(configuration);
+}
+
+QNetworkRequest ConnectionBenchmark::request(const QString &host, const QString &path) const
+{
+    QUrl url;
+    url.setScheme("https");
+    url.setHost(host);
+    url.setPort(mServer->serverPort());
+    url.setPath(path);
+
+    // As the application sends it; the manager adds HTTP/2 and TLS settings
+    return QNetworkRequest(url);
+}
+
+qreal ConnectionBenchmark::median(QVector<qreal> samples)
+{
+    std::sort(samples.begin(), samples.end());
+    return samples[samples.size() / 2];
+}
+
+void ConnectionBenchmark::firstRequest_data()
+{
+    QTest::addColumn<bool>("warmed");
+    QTest::newRow("cold") << false;
+    QTest::newRow("warmed") << true;
+}
+
+// Time to first byte of the first API call, with and without a connection
+// opened while the application was still starting up. One handshake in the
+// warmed case proves the request reused the connection warmUp() opened.
+void ConnectionBenchmark::firstRequest()
+{
+    QFETCH(bool, warmed);
+
+    QVector<qreal> samples;
+    for (int i = 0; i < rounds; ++i)
+    {
+        ApiNetworkAccessManager manager("localhost", mServer->serverPort());
+        const int handshakes = mServer->handshakes();
+        if (warmed)
+        {
+            QSignalSpy handshake(mServer.get(), &StandInServer::handshakeCompleted);
+            manager.warmUp();
+            QVERIFY(handshake.wait(timeout));
+        }
+
+        QElapsedTimer timer;
+        timer.start();
+        qint64 firstByte = -1;
+        auto reply = manager.get(request("localhost", "/tasks/v1/users/@me/lists"));
+        connect(reply, &QNetworkReply::metaDataChanged, this, [&firstByte, &timer]() {
+            if (firstByte < 0)
+            {
+                firstByte = timer.nsecsElapsed();
+            }
+        });
+        QSignalSpy finished(reply, &QNetworkReply::finished);
+        QVERIFY(finished.wait(timeout));
+        QCOMPARE(reply->error(), QNetworkReply::NoError);
+        QCOMPARE(mServer->handshakes() - handshakes, 1);
+        reply->deleteLater();
+
+        samples.append(firstByte / 1e6);
+    }
+    QTest::setBenchmarkResult(median(samples), QTest::WalltimeMilliseconds);
+}
+
+void ConnectionBenchmark::hosts_data()
+{
+    QTest::addColumn<QString>("tasksHost");
+    QTest::addColumn<int>("expectedHandshakes");
+    // 127.0.0.1 stands in for the second host name the lists used to go to
+    QTest::newRow("two hosts") << QString("127.0.0.1") << 2;
+    QTest::newRow("one host") << QString("localhost") << 1;
+}
+
+// Startup sequence: the task lists, then the tasks of the first list
+void ConnectionBenchmark::hosts()
+{
+    QFETCH(QString, tasksHost);
+    QFETCH(int, expectedHandshakes);
+
+    QVector<qreal> samples;
+    for (int i = 0; i < rounds; ++i)
+    {
+        ApiNetworkAccessManager manager("localhost", mServer->serverPort());
+        const int handshakes = mServer->handshakes();
+
+        QElapsedTimer timer;
+        timer.start();
+        for (const auto & next: {request("localhost", "/tasks/v1/users/@me/lists"),
+                                 request(tasksHost, "/tasks/v1/lists/standin/tasks")})
+        {
+            auto reply = manager.get(next);
+            QSignalSpy finished(reply, &QNetworkReply::finished);
+            QVERIFY(finished.wait(timeout));
+            QCOMPARE(reply->error(), QNetworkReply::NoError);
+            reply->deleteLater();
+        }
+        samples.append(timer.nsecsElapsed() / 1e6);
+        QCOMPARE(mServer->handshakes() - handshakes, expectedHandshakes);
+    }
+    QTest::setBenchmarkResult(median(samples), QTest::WalltimeMilliseconds);
+}
+
+// The warm-up connection offers h2, so a server that speaks it multiplexes
+// the API calls over that one connection. Only the negotiation is checked;
+// HTTP/2 multiplexing itself is not measured, the stand-in cannot speak it.
+void ConnectionBenchmark::alpn()
+{
+    StandInServer server(mCertificate, mKey, {QSslConfiguration::ALPNProtocolHTTP2,
+                                              QSslConfiguration::NextProtocolHttp1_1});
+    QVERIFY(server.listen(QHostAddress::LocalHost));
+
+    ApiNetworkAccessManager manager("localhost", server.serverPort());
+    QSignalSpy handshake(&server, &StandInServer::handshakeCompleted);
+    manager.warmUp();
+    QVERIFY(handshake.wait(timeout));
+    QCOMPARE(server.negotiatedProtocol(), QByteArray(QSslConfiguration::ALPNProtocolHTTP2));
+}
+
+QTEST_MAIN(ConnectionBenchmark)
+
+#include "tst_connection.moc"
@@ -0,0 +1,36 @@
+QT += testlib gui network networkauth
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TEMPLATE = app
+TARGET = tst_decode
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+APP_DIR = $$PWD/../..
+INCLUDEPATH += $$APP_DIR
+
+SOURCES += \
+    tst_decode.cpp \
+    $$APP_DIR/apicall.cpp \
+    $$APP_DIR/cancellation.cpp \
+    $$APP_DIR/jsonfields.cpp \
+    $$APP_DIR/jsonitemstream.cpp \
+    $$APP_DIR/metrics.cpp \
+    $$APP_DIR/taskcache.cpp \
+    $$APP_DIR/taskindex.cpp \
+    $$APP_DIR/tasklist.cpp \
+    $$APP_DIR/tasksapi.cpp
+
+HEADERS += \
+    $$APP_DIR/apicall.h \
+    $$APP_DIR/cancellation.h \
+    $$APP_DIR/jsonfields.h \
+    $$APP_DIR/jsonitemstream.h \
+    $$APP_DIR/metrics.h \
+    $$APP_DIR/taskcache.h \
+    $$APP_DIR/taskindex.h \
+    $$APP_DIR/tasklist.h \
+    $$APP_DIR/tasksapi.h \
+    $$APP_DIR/tasksnapshot.h
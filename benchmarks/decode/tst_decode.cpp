@@ -0,0 +1,174 @@
+#include <limits>
+
+#include <QtTest>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QVariant>
+
+#include "tasklist.h"
+
+constexpr int batch_size = 10000;
+constexpr int throughput_rounds = 10;
+
+static QJsonArray makeTasks(int count)
+{
+    QJsonArray tasks;
+    for (int i = 0; i < count; ++i)
+    {
+        QJsonObject task{
+            {"kind", "tasks#task"},
+            {"id", QString("MTIzNDU2Nzg5MDEyMzQ1Njc4OTA6MDo%1").arg(i)},
+            {"etag", QString("\"LTEyMzQ1Njc4OQ/%1\"").arg(i)},
+            {"title", QString("Task %1").arg(i)},
+            {"updated", "2024-01-31T09:30:12.345Z"},
+            {"selfLink", QString("https://tasks.googleapis.com/tasks/v1/lists/list/tasks/%1").arg(i)},
+            {"position", QString("%1").arg(i, 20, 10, QChar('0'))},
+            {"status", i % 3 ? "needsAction" : "completed"},
+            {"due", "2024-02-15T00:00:00.000Z"},
+            {"notes", "Some notes"},
+            {"links", QJsonArray{}}
+        };
+        if (i % 3 == 0)
+        {
+            task["completed"] = "2024-01-30T18:00:00.000Z";
+        }
+        tasks.append(task);
+    }
+    return tasks;
+}
+
+// Decoding as Task did before the field tables: a hash lookup per member and
+// dates through QVariant
+struct LookupTask
+{
+    explicit LookupTask(const QJsonObject & taskObject):
+        kind(taskObject["kind"].toString()),
+        id(taskObject["id"].toString()),
+        etag(taskObject["etag"].toString()),
+        title(taskObject["title"].toString()),
+        updated(taskObject["updated"].toVariant().toDateTime()),
+        selfLink(taskObject["selfLink"].toString()),
+        position(taskObject["position"].toVariant().toULongLong()),
+        status(taskObject["status"].toString()),
+        due(taskObject["due"].toVariant().toDateTime()),
+        completed(taskObject["completed"].toVariant().toDateTime()),
+        notes(taskObject["notes"].toString())
+    {
+    }
+
+    QString kind;
+    QString id;
+    QString etag;
+    QString title;
+    QDateTime updated;
+    QUrl selfLink;
+    unsigned long position;
+    QString status;
+    QDateTime due;
+    QDateTime completed;
+    QString notes;
+};
+
+class DecodeBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void decode_data();
+    void decode();
+    void parseDate_data();
+    void parseDate();
+    void roundTrip();
+
+private:
+    QJsonArray mTasks;
+};
+
+void DecodeBenchmark::initTestCase()
+{
+    mTasks = makeTasks(batch_size);
+}
+
+void DecodeBenchmark::decode_data()
+{
+    QTest::addColumn<bool>("fieldTable");
+    QTest::newRow("lookups") << false;
+    QTest::newRow("field table") << true;
+}
+
+// Time per batch of batch_size tasks; tasks/s is logged separately
+void DecodeBenchmark::decode()
+{
+    QFETCH(bool, fieldTable);
+
+    const auto decodeBatch = [this, fieldTable]() {
+        for (const auto & i: qAsConst(mTasks))
+        {
+            if (fieldTable)
+            {
+                Task task(i.toObject(), nullptr);
+            }
+            else
+            {
+                LookupTask task(i.toObject());
+            }
+        }
+    };
+
+    QBENCHMARK
+    {
+        decodeBatch();
+    }
+
+    qint64 best = std::numeric_limits<qint64>::max();
+    for (int i = 0; i < throughput_rounds; ++i)
+    {
+        QElapsedTimer timer;
+        timer.start();
+        decodeBatch();
+        best = qMin(best, timer.nsecsElapsed());
+    }
+    qInfo().noquote() << QString("%1 tasks/s").arg(batch_size * 1e9 / best, 0, 'f', 0);
+}
+
+void DecodeBenchmark::parseDate_data()
+{
+    QTest::addColumn<bool>("rfc3339");
+    QTest::newRow("QVariant") << false;
+    QTest::newRow("parseRfc3339") << true;
+}
+
+void DecodeBenchmark::parseDate()
+{
+    QFETCH(bool, rfc3339);
+    const QString text("2024-01-31T09:30:12.345Z");
+
+    QDateTime result;
+    QBENCHMARK
+    {
+        result = rfc3339 ? parseRfc3339(text) : QVariant(text).toDateTime();
+    }
+    QCOMPARE(result, QDateTime(QDate(2024, 1, 31), QTime(9, 30, 12, 345), Qt::UTC));
+}
+
+// The same table encodes, so a decoded task must encode back to its input
+void DecodeBenchmark::roundTrip()
+{
+    for (const auto & i: makeTasks(3))
+    {
+        auto expected = i.toObject();
+        expected.remove("links");
+        QCOMPARE(Task(i.toObject(), nullptr).toJson(), expected);
+    }
+
+    const Task task(mTasks.first().toObject(), nullptr);
+    const auto patch = task.toJson({QLatin1String("status"), QLatin1String("completed")});
+    QCOMPARE(patch.keys(), QStringList({"completed", "status"}));
+}
+
+QTEST_MAIN(DecodeBenchmark)
+
+#include "tst_decode.moc"
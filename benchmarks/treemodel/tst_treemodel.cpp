@@ -0,0 +1,435 @@
+#include <limits>
+#include <memory>
+
+#include <QtTest>
+#include <QMimeData>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QStandardPaths>
+
+#include "tasklist.h"
+
+// Synthetic trees: one task list per thousand nodes, the rest are tasks
+static QJsonArray makeTaskLists(int nodes)
+{
+    const int count = qBound(1, nodes / 1000, 100);
+    QJsonArray taskLists;
+    for (int i = 0; i < count; ++i)
+    {
+        taskLists.append(QJsonObject{
+            {"kind", "tasks#taskList"},
+            {"id", QString("list%1").arg(i)},
+            {"etag", QString("\"list%1\"").arg(i)},
+            {"title", QString("Task list %1").arg(i)},
+            {"updated", "2024-01-01T00:00:00.000Z"}
+        });
+    }
+    return taskLists;
+}
+
+static QJsonArray makeTasks(const QString & taskListId, int count)
+{
+    QJsonArray tasks;
+    for (int i = 0; i < count; ++i)
+    {
+        const bool completed = i % 3 == 0;
+        QJsonObject task{
+            {"kind", "tasks#task"},
+            {"id", QString("%1-task%2").arg(taskListId).arg(i)},
+            {"etag", QString("\"%1\"").arg(i)},
+            {"title", QString("Task %1").arg(i)},
+            {"updated", "2024-01-01T00:00:00.000Z"},
+            {"position", QString("%1").arg(i, 20, 10, QChar('0'))},
+            {"status", completed ? "completed" : "needsAction"},
+            {"due", QString("2024-02-%1T00:00:00.000Z").arg(i % 28 + 1, 2, 10, QChar('0'))},
+            {"notes", "Some notes"}
+        };
+        if (completed)
+        {
+            task["completed"] = "2024-01-15T12:00:00.000Z";
+        }
+        tasks.append(task);
+    }
+    return tasks;
+}
+
+// Everything a reader of the snapshot can see
+static QStringList describe(const TaskTreeSnapshot & snapshot)
+{
+    QStringList lines;
+    for (const auto & taskList: snapshot.taskLists)
+    {
+        lines << QString("%1 %2 %3/%4 %5").arg(taskList->id, taskList->title).arg(taskList->openCount)
+                 .arg(taskList->completedCount).arg(taskList->evicted);
+        for (const auto & task: taskList->tasks)
+        {
+            lines << QString("  %1 %2 %3").arg(task->id, task->title, task->status);
+        }
+    }
+    return lines;
+}
+
+// Publishing is queued behind the edits it coalesces
+static TaskTreeSnapshotPtr published(const TreeModel & model)
+{
+    QCoreApplication::processEvents();
+    return model.snapshot();
+}
+
+class TreeModelBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void index_data();
+    void index();
+    void parent_data();
+    void parent();
+    void rowCount_data();
+    void rowCount();
+    void taskData_data();
+    void taskData();
+    void taskListData_data();
+    void taskListData();
+    void setData_data();
+    void setData();
+    void buildAndDestroy_data();
+    void buildAndDestroy();
+    void moveBlock_data();
+    void moveBlock();
+    void snapshotSharing();
+
+private:
+    void addSizes();
+    std::unique_ptr<TreeModel> makeModel(int nodes);
+    static QModelIndex lastTask(const TreeModel & model);
+};
+
+void TreeModelBenchmark::initTestCase()
+{
+    // setTasks() writes the offline cache; keep it away from real user data
+    QStandardPaths::setTestModeEnabled(true);
+}
+
+void TreeModelBenchmark::addSizes()
+{
+    QTest::addColumn<int>("nodes");
+    for (int nodes: {10, 100, 1000, 10000, 100000})
+    {
+        QTest::newRow(qPrintable(QString::number(nodes))) << nodes;
+    }
+}
+
+std::unique_ptr<TreeModel> TreeModelBenchmark::makeModel(int nodes)
+{
+    const auto taskLists = makeTaskLists(nodes);
+    // A null flow never touches the network; tasks come in through setTasks()
+    auto model = std::make_unique<TreeModel>(taskLists, nullptr);
+    model->setMemoryBudget(std::numeric_limits<qint64>::max());
+
+    const int perList = qMax(1, nodes / taskLists.size() - 1);
+    for (const auto & i: taskLists)
+    {
+        const auto id = i.toObject()["id"].toString();
+        model->setTasks(id, makeTasks(id, perList));
+    }
+    return model;
+}
+
+// The deepest task of the last list, the worst case for row() lookups. The
+// list's last row is its completed section.
+QModelIndex TreeModelBenchmark::lastTask(const TreeModel &model)
+{
+    const auto taskList = model.index(model.rowCount() - 1, 0);
+    return model.index(model.rowCount(taskList) - 2, 0, taskList);
+}
+
+void TreeModelBenchmark::index_data()
+{
+    addSizes();
+}
+
+void TreeModelBenchmark::index()
+{
+    QFETCH(int, nodes);
+    const auto model = makeModel(nodes);
+    const auto taskList = model->index(model->rowCount() - 1, 0);
+    const int row = model->rowCount(taskList) - 2;
+
+    QModelIndex result;
+    QBENCHMARK
+    {
+        result = model->index(row, 0, taskList);
+    }
+    QVERIFY(result.isValid());
+}
+
+void TreeModelBenchmark::parent_data()
+{
+    addSizes();
+}
+
+void TreeModelBenchmark::parent()
+{
+    QFETCH(int, nodes);
+    const auto model = makeModel(nodes);
+    const auto task = lastTask(*model);
+
+    QModelIndex result;
+    QBENCHMARK
+    {
+        result = model->parent(task);
+    }
+    QCOMPARE(result.row(), model->rowCount() - 1);
+}
+
+void TreeModelBenchmark::rowCount_data()
+{
+    addSizes();
+}
+
+void TreeModelBenchmark::rowCount()
+{
+    QFETCH(int, nodes);
+    const auto model = makeModel(nodes);
+    const auto taskList = model->index(model->rowCount() - 1, 0);
+
+    int result = 0;
+    QBENCHMARK
+    {
+        result = model->rowCount(taskList);
+    }
+    QVERIFY(result > 0);
+}
+
+void TreeModelBenchmark::taskData_data()
+{
+    QTest::addColumn<int>("nodes");
+    QTest::addColumn<int>("role");
+    const QList<QPair<const char *, int>> roles{
+        {"display", Qt::DisplayRole},
+        {"checkState", Qt::CheckStateRole},
+        {"sizeHint", Qt::SizeHintRole},
+        {"foreground", Qt::ForegroundRole},
+        {"decoration", Qt::DecorationRole}
+    };
+    for (int nodes: {10, 100, 1000, 10000, 100000})
+    {
+        for (const auto & role: roles)
+        {
+            QTest::newRow(qPrintable(QString("%1/%2").arg(nodes).arg(role.first))) << nodes << role.second;
+        }
+    }
+}
+
+void TreeModelBenchmark::taskData()
+{
+    QFETCH(int, nodes);
+    QFETCH(int, role);
+    const auto model = makeModel(nodes);
+    const auto task = lastTask(*model);
+
+    QVariant result;
+    QBENCHMARK
+    {
+        result = model->data(task, role);
+    }
+    // Only lists have an icon
+    QCOMPARE(result.isValid(), role != Qt::DecorationRole);
+}
+
+void TreeModelBenchmark::taskListData_data()
+{
+    QTest::addColumn<int>("nodes");
+    QTest::addColumn<int>("role");
+    const QList<QPair<const char *, int>> roles{
+        {"display", Qt::DisplayRole},
+        {"toolTip", Qt::ToolTipRole},
+        {"sizeHint", Qt::SizeHintRole},
+        {"decoration", Qt::DecorationRole},
+        {"openCount", TreeModel::OpenCountRole},
+        {"completedCount", TreeModel::CompletedCountRole},
+        {"lastActivity", TreeModel::LastActivityRole}
+    };
+    for (int nodes: {10, 100, 1000, 10000, 100000})
+    {
+        for (const auto & role: roles)
+        {
+            QTest::newRow(qPrintable(QString("%1/%2").arg(nodes).arg(role.first))) << nodes << role.second;
+        }
+    }
+}
+
+void TreeModelBenchmark::taskListData()
+{
+    QFETCH(int, nodes);
+    QFETCH(int, role);
+    const auto model = makeModel(nodes);
+    const auto taskList = model->index(model->rowCount() - 1, 0);
+
+    QVariant result;
+    QBENCHMARK
+    {
+        result = model->data(taskList, role);
+    }
+    QVERIFY(result.isValid());
+}
+
+void TreeModelBenchmark::setData_data()
+{
+    addSizes();
+}
+
+void TreeModelBenchmark::setData()
+{
+    QFETCH(int, nodes);
+    const auto model = makeModel(nodes);
+    const auto task = lastTask(*model);
+
+    // Alternate so every call is a real change with full notification cost
+    bool checked = model->data(task, Qt::CheckStateRole).toInt() == Qt::Checked;
+    QBENCHMARK
+    {
+        checked = !checked;
+        model->setData(task, checked ? Qt::Checked : Qt::Unchecked, Qt::CheckStateRole);
+    }
+    QCOMPARE(model->data(task, Qt::CheckStateRole).toInt() == Qt::Checked, checked);
+}
+
+void TreeModelBenchmark::buildAndDestroy_data()
+{
+    addSizes();
+}
+
+void TreeModelBenchmark::buildAndDestroy()
+{
+    QFETCH(int, nodes);
+    const auto taskLists = makeTaskLists(nodes);
+    const int perList = qMax(1, nodes / taskLists.size() - 1);
+    QVector<QJsonArray> tasks;
+    for (const auto & i: taskLists)
+    {
+        tasks.append(makeTasks(i.toObject()["id"].toString(), perList));
+    }
+
+    QBENCHMARK
+    {
+        TreeItem root;
+        for (int i = 0; i < taskLists.size(); ++i)
+        {
+            auto taskList = new TaskList(taskLists[i].toObject(), &root);
+            root.appendChild(taskList);
+            for (const auto & task: tasks[i])
+            {
+                taskList->appendChild(new Task(task.toObject(), taskList));
+            }
+        }
+    }
+}
+
+void TreeModelBenchmark::moveBlock_data()
+{
+    QTest::addColumn<int>("block");
+    for (int block: {1, 50, 500})
+    {
+        QTest::newRow(qPrintable(QString::number(block))) << block;
+    }
+}
+
+// Drags the last tasks of one list to the end of the other, back and forth.
+// However large the block, a drop is one row move and never a reset.
+void TreeModelBenchmark::moveBlock()
+{
+    QFETCH(int, block);
+    const auto model = makeModel(2000);
+    QCOMPARE(model->rowCount(), 2);
+    QSignalSpy moves(model.get(), &QAbstractItemModel::rowsMoved);
+    QSignalSpy resets(model.get(), &QAbstractItemModel::modelReset);
+
+    int drops = 0;
+    QVector<TreeItem*> dropped;
+    QBENCHMARK
+    {
+        const auto source = model->index(drops % 2, 0);
+        const auto destination = model->index(1 - drops % 2, 0);
+        // The last row is the completed section
+        const int end = model->rowCount(source) - 1;
+        QModelIndexList indexes;
+        dropped.clear();
+        for (int i = end - block; i < end; ++i)
+        {
+            indexes.append(model->index(i, 0, source));
+            dropped.append(static_cast<TreeItem*>(indexes.last().internalPointer()));
+        }
+        std::unique_ptr<QMimeData> data(model->mimeData(indexes));
+        QVERIFY(model->dropMimeData(data.get(), Qt::MoveAction, -1, 0, destination));
+        ++drops;
+    }
+    QCOMPARE(moves.count(), drops);
+    QCOMPARE(resets.count(), 0);
+
+    // The block ends the destination in the order it was dragged
+    const auto destination = model->index(drops % 2, 0);
+    const int end = model->rowCount(destination) - 1;
+    for (int i = 0; i < block; ++i)
+    {
+        QCOMPARE(model->index(end - block + i, 0, destination).internalPointer(), static_cast<void*>(dropped[i]));
+    }
+}
+
+// Published versions never change afterwards, and a new version shares the
+// nodes of every list that was not touched in between
+void TreeModelBenchmark::snapshotSharing()
+{
+    const auto model = makeModel(3000);
+    QCOMPARE(model->rowCount(), 3);
+    const auto first = published(*model);
+    QVERIFY(first);
+    const auto firstContent = describe(*first);
+
+    // An edit in the first list, a move in the second, the third untouched
+    const auto edited = model->index(0, 0, model->index(0, 0));
+    QVERIFY(model->setData(edited, "Edited", Qt::EditRole));
+    const auto moveSource = model->index(1, 0);
+    std::unique_ptr<QMimeData> data(model->mimeData({model->index(0, 0, moveSource)}));
+    QVERIFY(model->dropMimeData(data.get(), Qt::MoveAction, -1, 0, moveSource));
+
+    const auto second = published(*model);
+    QVERIFY(second->version > first->version);
+    QCOMPARE(describe(*first), firstContent);
+    QVERIFY(describe(*second) != firstContent);
+    QVERIFY(second->taskLists[0] != first->taskLists[0]);
+    QVERIFY(second->taskLists[1] != first->taskLists[1]);
+    QVERIFY(second->taskLists[2] == first->taskLists[2]);
+    // Within a changed list, only the changed task gets a new node
+    QVERIFY(second->taskLists[0]->tasks[0] != first->taskLists[0]->tasks[0]);
+    QVERIFY(second->taskLists[0]->tasks[1] == first->taskLists[0]->tasks[1]);
+    const auto secondContent = describe(*second);
+
+    // Squeezing the budget evicts at least one list
+    model->setMemoryBudget(model->memoryUsage() - 1);
+    const auto third = published(*model);
+    QCOMPARE(describe(*first), firstContent);
+    QCOMPARE(describe(*second), secondContent);
+    int evicted = 0;
+    for (int i = 0; i < third->taskLists.size(); ++i)
+    {
+        if (third->taskLists[i]->evicted)
+        {
+            ++evicted;
+            QVERIFY(third->taskLists[i]->tasks.isEmpty());
+            QVERIFY(!second->taskLists[i]->tasks.isEmpty());
+        }
+        else
+        {
+            QVERIFY(third->taskLists[i] == second->taskLists[i]);
+        }
+    }
+    QVERIFY(evicted > 0);
+}
+
+QTEST_MAIN(TreeModelBenchmark)
+
+#include "tst_treemodel.moc"
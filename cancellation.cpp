@@ -0,0 +1,80 @@
+#include "cancellation.h"
+
+#include <utility>
+
+struct CancellationToken::State
+{
+    bool cancelled = false;
+    int nextId = 0;
+    QHash<int, std::function<void()>> callbacks;
+};
+
+CancellationToken::CancellationToken(std::shared_ptr<State> state):
+    mState(std::move(state))
+{
+
+}
+
+bool CancellationToken::isCancelled() const
+{
+    return mState && mState->cancelled;
+}
+
+int CancellationToken::onCancel(std::function<void()> callback) const
+{
+    if (!mState)
+    {
+        return -1;
+    }
+    if (mState->cancelled)
+    {
+        callback();
+        return -1;
+    }
+    mState->callbacks.insert(mState->nextId, std::move(callback));
+    return mState->nextId++;
+}
+
+void CancellationToken::unregister(int id) const
+{
+    if (mState)
+    {
+        mState->callbacks.remove(id);
+    }
+}
+
+CancellationSource::CancellationSource():
+    mState(std::make_shared<CancellationToken::State>())
+{
+
+}
+
+CancellationSource::~CancellationSource()
+{
+    cancel();
+}
+
+CancellationToken CancellationSource::token() const
+{
+    return CancellationToken(mState);
+}
+
+void CancellationSource::cancel()
+{
+    if (std::exchange(mState->cancelled, true))
+    {
+        return;
+    }
+    // Callbacks may unregister others or hand out tokens while this runs
+    const auto callbacks = std::exchange(mState->callbacks, {});
+    for (const auto & i: callbacks)
+    {
+        i();
+    }
+}
+
+void CancellationSource::reset()
+{
+    cancel();
+    mState = std::make_shared<CancellationToken::State>();
+}
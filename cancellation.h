@@ -0,0 +1,53 @@
+#ifndef CANCELLATION_H
+#define CANCELLATION_H
+
+#include <functional>
+#include <memory>
+
+#include <QHash>
+
+// Cooperative cancellation for work owned by an object. The owner keeps a
+// CancellationSource and hands out tokens; cancelling the source, resetting
+// it or destroying it fires every token handed out so far, once.
+class CancellationToken
+{
+public:
+    // A token that is never cancelled
+    CancellationToken() = default;
+
+    bool isCancelled() const;
+
+    // Runs callback when the token fires, right away if it already has. The
+    // returned id unregisters it, for work that finished on its own.
+    int onCancel(std::function<void()> callback) const;
+    void unregister(int id) const;
+
+private:
+    friend class CancellationSource;
+    struct State;
+
+    explicit CancellationToken(std::shared_ptr<State> state);
+
+    std::shared_ptr<State> mState;
+};
+
+class CancellationSource
+{
+public:
+    CancellationSource();
+    ~CancellationSource();
+
+    CancellationSource(const CancellationSource &) = delete;
+    CancellationSource & operator=(const CancellationSource &) = delete;
+
+    CancellationToken token() const;
+
+    void cancel();
+    // Cancels what was started so far; later tokens belong to a fresh scope
+    void reset();
+
+private:
+    std::shared_ptr<CancellationToken::State> mState;
+};
+
+#endif // CANCELLATION_H
@@ -0,0 +1,84 @@
+#include "jsonfields.h"
+
+// Value of count digits at from, -1 if any of them is not a digit
+static int digits(QStringView text, int from, int count)
+{
+    int value = 0;
+    for (int i = from; i < from + count; ++i)
+    {
+        const auto c = text[i].unicode();
+        if (c < '0' || c > '9')
+        {
+            return -1;
+        }
+        value = value * 10 + (c - '0');
+    }
+    return value;
+}
+
+QDateTime parseRfc3339(QStringView text)
+{
+    // YYYY-MM-DDTHH:MM:SS, then optional fraction, then Z or +HH:MM / -HH:MM
+    if (text.size() < 20 || text[4] != '-' || text[7] != '-' || (text[10] != 'T' && text[10] != 't')
+            || text[13] != ':' || text[16] != ':')
+    {
+        return {};
+    }
+    const int year = digits(text, 0, 4);
+    const int month = digits(text, 5, 2);
+    const int day = digits(text, 8, 2);
+    const int hour = digits(text, 11, 2);
+    const int minute = digits(text, 14, 2);
+    const int second = digits(text, 17, 2);
+    if (year < 0 || month < 0 || day < 0 || hour < 0 || minute < 0 || second < 0)
+    {
+        return {};
+    }
+
+    int i = 19;
+    int msec = 0;
+    if (text[i] == '.')
+    {
+        int scale = 100;
+        for (++i; i < text.size() && text[i] >= '0' && text[i] <= '9'; ++i)
+        {
+            msec += (text[i].unicode() - '0') * scale;
+            scale /= 10;
+        }
+    }
+
+    int offset = 0;
+    if (i + 1 == text.size() && (text[i] == 'Z' || text[i] == 'z'))
+    {
+        offset = 0;
+    }
+    else if (i + 6 == text.size() && (text[i] == '+' || text[i] == '-') && text[i + 3] == ':')
+    {
+        const int offsetHours = digits(text, i + 1, 2);
+        const int offsetMinutes = digits(text, i + 4, 2);
+        if (offsetHours < 0 || offsetMinutes < 0)
+        {
+            return {};
+        }
+        offset = (offsetHours * 60 + offsetMinutes) * 60 * (text[i] == '-' ? -1 : 1);
+    }
+    else
+    {
+        return {};
+    }
+
+    const QDate date(year, month, day);
+    // Leap seconds are folded into the last regular one
+    const QTime time(hour, minute, qMin(second, 59), msec);
+    if (!date.isValid() || !time.isValid())
+    {
+        return {};
+    }
+    QDateTime dateTime(date, time, Qt::UTC);
+    return offset ? dateTime.addSecs(-offset) : dateTime;
+}
+
+QString formatRfc3339(const QDateTime &dateTime)
+{
+    return dateTime.toUTC().toString(Qt::ISODateWithMs);
+}
@@ -0,0 +1,106 @@
+#ifndef JSONFIELDS_H
+#define JSONFIELDS_H
+
+#include <algorithm>
+#include <initializer_list>
+#include <tuple>
+
+#include <QDateTime>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QLatin1String>
+#include <QStringView>
+#include <QUrl>
+
+// Binds a JSON member name to a data member. A type lists its bindings once
+// in a constexpr tuple; decodeJson() and encodeJson() are expanded from that
+// tuple at compile time, so there is no per-field lookup code to keep in
+// sync with the members.
+template<typename Class, typename Member>
+struct JsonField
+{
+    QLatin1String name;
+    Member Class::*member;
+};
+
+template<typename Class, typename Member, int N>
+constexpr JsonField<Class, Member> jsonField(const char (&name)[N], Member Class::*member)
+{
+    return {QLatin1String(name, N - 1), member};
+}
+
+// RFC 3339 timestamps as sent by Google APIs ("2024-01-31T09:30:00.000Z");
+// anything malformed decodes to a null QDateTime
+QDateTime parseRfc3339(QStringView text);
+QString formatRfc3339(const QDateTime & dateTime);
+
+inline void fromJson(const QJsonValue & value, QString & out)
+{
+    out = value.toString();
+}
+
+inline void fromJson(const QJsonValue & value, QUrl & out)
+{
+    out = QUrl(value.toString());
+}
+
+inline void fromJson(const QJsonValue & value, QDateTime & out)
+{
+    out = parseRfc3339(value.toString());
+}
+
+inline QJsonValue toJson(const QString & value)
+{
+    return value.isNull() ? QJsonValue{} : QJsonValue{value};
+}
+
+inline QJsonValue toJson(const QUrl & value)
+{
+    return value.isEmpty() ? QJsonValue{} : QJsonValue{value.toString()};
+}
+
+inline QJsonValue toJson(const QDateTime & value)
+{
+    return value.isValid() ? QJsonValue{formatRfc3339(value)} : QJsonValue{};
+}
+
+// One pass over the members of json; each key is matched against the field
+// names, which differ in length or first letter almost everywhere, and
+// unknown keys are skipped
+template<typename Object, typename... Fields>
+void decodeJson(const QJsonObject & json, Object & object, const std::tuple<Fields...> & fields)
+{
+    for (auto it = json.constBegin(); it != json.constEnd(); ++it)
+    {
+        const auto key = it.key();
+        std::apply([&](const auto &... field) {
+            (void)((key == field.name && (fromJson(it.value(), object.*field.member), true)) || ...);
+        }, fields);
+    }
+}
+
+// Without names, every field that has a value; with names, exactly those
+// fields, null ones included, as a PATCH body needs to clear them
+template<typename Object, typename... Fields>
+QJsonObject encodeJson(const Object & object, const std::tuple<Fields...> & fields,
+                       std::initializer_list<QLatin1String> names = {})
+{
+    QJsonObject json;
+    const auto encode = [&](const auto & field) {
+        const bool selected = std::find(names.begin(), names.end(), field.name) != names.end();
+        if (names.size() && !selected)
+        {
+            return;
+        }
+        if (const auto value = toJson(object.*field.member); selected || !value.isNull())
+        {
+            json.insert(field.name, value);
+        }
+    };
+    std::apply([&](const auto &... field) {
+        (encode(field), ...);
+    }, fields);
+    return json;
+}
+
+#endif // JSONFIELDS_H
@@ -0,0 +1,170 @@
+#include "jsonitemstream.h"
+
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QElapsedTimer>
+
+#include "metrics.h"
+
+JsonItemStream::JsonItemStream(ItemHandler onItem):
+    mOnItem(std::move(onItem))
+{
+
+}
+
+bool JsonItemStream::feed(const QByteArray &chunk)
+{
+    if (mError)
+    {
+        return false;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // A capture that spans chunks restarts at the beginning of this one
+    mCaptureFrom = mCapture == Capture::None ? -1 : 0;
+
+    const auto data = chunk.constData();
+    for (int i = 0; i < chunk.size() && !mError; ++i)
+    {
+        const char c = data[i];
+        if (mInString)
+        {
+            if (mEscape)
+            {
+                mEscape = false;
+            }
+            else if (c == '\\')
+            {
+                mEscape = true;
+            }
+            else if (c == '"')
+            {
+                mInString = false;
+                if (mCapture == Capture::Key || mCapture == Capture::Value)
+                {
+                    endCapture(chunk, i);
+                }
+            }
+            continue;
+        }
+
+        switch (c)
+        {
+        case '"':
+            mInString = true;
+            if (mDepth == 1)
+            {
+                beginCapture(mExpectKey ? Capture::Key : Capture::Value, i);
+            }
+            break;
+        case '{':
+        case '[':
+            if (mDepth == 2 && mInItems && c == '{')
+            {
+                beginCapture(Capture::Item, i);
+            }
+            else if (mDepth == 1 && c == '[' && mKey == "items")
+            {
+                mInItems = true;
+            }
+            if (++mDepth == 1)
+            {
+                mExpectKey = true;
+            }
+            break;
+        case '}':
+        case ']':
+            if (--mDepth < 0)
+            {
+                mError = true;
+            }
+            else if (mDepth == 2 && mCapture == Capture::Item)
+            {
+                endCapture(chunk, i);
+            }
+            else if (mDepth == 1)
+            {
+                mInItems = false;
+            }
+            else if (mDepth == 0)
+            {
+                mDone = true;
+            }
+            break;
+        case ':':
+            if (mDepth == 1)
+            {
+                mExpectKey = false;
+            }
+            break;
+        case ',':
+            if (mDepth == 1)
+            {
+                mExpectKey = true;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    if (mCaptureFrom >= 0)
+    {
+        mCaptured.append(data + mCaptureFrom, chunk.size() - mCaptureFrom);
+    }
+
+    // Includes the item handlers, which decode what was tokenized
+    auto & metrics = Metrics::instance();
+    metrics.increment(metric_json_parse_seconds, {}, timer.nsecsElapsed() / 1e9);
+    metrics.increment(metric_json_parsed_bytes, {}, chunk.size());
+    return !mError;
+}
+
+bool JsonItemStream::atEnd() const
+{
+    return mDone;
+}
+
+bool JsonItemStream::hasError() const
+{
+    return mError;
+}
+
+QString JsonItemStream::field(const QString &name) const
+{
+    return mFields.value(name);
+}
+
+void JsonItemStream::beginCapture(Capture capture, int from)
+{
+    mCapture = capture;
+    mCaptureFrom = from;
+    mCaptured.clear();
+}
+
+void JsonItemStream::endCapture(const QByteArray &chunk, int to)
+{
+    mCaptured.append(chunk.constData() + mCaptureFrom, to - mCaptureFrom + 1);
+
+    switch (mCapture)
+    {
+    case Capture::Key:
+        // API member names never carry escapes
+        mKey = QString::fromUtf8(mCaptured.mid(1, mCaptured.size() - 2));
+        break;
+    case Capture::Value:
+        mFields.insert(mKey, QJsonDocument::fromJson("[" + mCaptured + "]").array().first().toString());
+        break;
+    case Capture::Item:
+        mOnItem(mCaptured);
+        break;
+    case Capture::None:
+        break;
+    }
+
+    mCapture = Capture::None;
+    mCaptureFrom = -1;
+    mCaptured.clear();
+}
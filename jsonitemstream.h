@@ -0,0 +1,59 @@
+#ifndef JSONITEMSTREAM_H
+#define JSONITEMSTREAM_H
+
+#include <functional>
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+
+// Incremental tokenizer for Google API collection responses
+// ({"kind": ..., "etag": ..., "nextPageToken": ..., "items": [{...}, ...]}).
+// Bytes are fed as they arrive; every object of the top-level "items" array
+// is handed out as raw JSON the moment its closing brace is seen, and
+// top-level string members are kept for lookup. Only the item currently being
+// read is buffered, never the whole body.
+class JsonItemStream
+{
+public:
+    using ItemHandler = std::function<void(const QByteArray & item)>;
+
+    explicit JsonItemStream(ItemHandler onItem);
+
+    // Returns false once the input turned out to be malformed
+    bool feed(const QByteArray & chunk);
+
+    bool atEnd() const;
+    bool hasError() const;
+    QString field(const QString & name) const;
+
+private:
+    enum class Capture
+    {
+        None,
+        Key,
+        Value,
+        Item
+    };
+
+    void beginCapture(Capture capture, int from);
+    void endCapture(const QByteArray & chunk, int to);
+
+    ItemHandler mOnItem;
+
+    QHash<QString, QString> mFields;
+    QString mKey;
+    QByteArray mCaptured;
+    Capture mCapture = Capture::None;
+    int mCaptureFrom = -1;
+
+    int mDepth = 0;
+    bool mInString = false;
+    bool mEscape = false;
+    bool mExpectKey = false;
+    bool mInItems = false;
+    bool mDone = false;
+    bool mError = false;
+};
+
+#endif // JSONITEMSTREAM_H
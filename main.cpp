@@ -1,14 +1,101 @@
 #include "mainwindow.h"
 
+#include <utility>
+
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QFileInfo>
+#include <QDebug>
+
+#include "taskexporter.h"
+#include "metricsserver.h"
+
+static int runExport(QApplication & app, const QString & fileName, const QString & format, bool offline)
+{
+    const auto exportFormat = (format == "csv" || (format.isEmpty() && QFileInfo(fileName).suffix() == "csv"))
+            ? TaskExporter::Format::Csv
+            : TaskExporter::Format::Jsonl;
+
+    auto auth = std::make_shared<AuthManager>();
+    TaskExporter exporter(auth->flow());
+    QObject::connect(&exporter, &TaskExporter::finished, [&app](bool success, qint64 tasksWritten) {
+        qInfo() << "Exported" << tasksWritten << "tasks";
+        app.exit(success ? 0 : 1);
+    });
+
+    if (offline)
+    {
+        return exporter.start(fileName, exportFormat, TaskExporter::Source::Snapshot) ? app.exec() : 1;
+    }
+
+    if (auth->initStatus() != AuthManager::InitFromCacheStatus::Success)
+    {
+        qCritical() << "Log in from the application once before exporting";
+        return 1;
+    }
+    // Start with a fresh token rather than failing on an expired cached one
+    bool started = false;
+    QObject::connect(auth->flow().get(), &QOAuth2AuthorizationCodeFlow::granted, [&]() {
+        if (std::exchange(started, true))
+        {
+            return;
+        }
+        if (!exporter.start(fileName, exportFormat, TaskExporter::Source::Network))
+        {
+            app.exit(1);
+        }
+    });
+    // A revoked or unreachable grant must not leave the export waiting forever
+    QObject::connect(auth->flow().get(), &QAbstractOAuth2::error, [&app](const QString & error, const QString & description) {
+        qCritical() << "Authorization failed:" << error << description;
+        app.exit(1);
+    });
+    QObject::connect(auth->flow().get(), &QAbstractOAuth::statusChanged, [&app, &started](QAbstractOAuth::Status status) {
+        if (status == QAbstractOAuth::Status::NotAuthenticated && !started)
+        {
+            qCritical() << "Authorization failed: the token could not be refreshed";
+            app.exit(1);
+        }
+    });
+    auth->flow()->refreshAccessToken();
+    return app.exec();
+}
 
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
 
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption memoryBudgetOption("memory-budget",
+                                          "Keep at most <MiB> of task data in memory; collapsed lists are evicted beyond that.",
+                                          "MiB");
+    QCommandLineOption exportOption("export", "Stream all tasks to <file> and exit.", "file");
+    QCommandLineOption formatOption("format", "Export format: jsonl or csv. Defaults to the file extension.", "format");
+    QCommandLineOption offlineOption("offline", "Export from the local snapshot instead of the API.");
+    QCommandLineOption metricsPortOption("metrics-port", "Serve Prometheus metrics on http://127.0.0.1:<port>/metrics.", "port");
+    parser.addOptions({memoryBudgetOption, exportOption, formatOption, offlineOption, metricsPortOption});
+    parser.process(a);
+
+    MetricsServer metricsServer;
+    if (parser.isSet(metricsPortOption) && !metricsServer.listen(parser.value(metricsPortOption).toUShort()))
+    {
+        qCritical() << "Cannot serve metrics:" << metricsServer.errorString();
+        return 1;
+    }
+
+    if (parser.isSet(exportOption))
+    {
+        return runExport(a, parser.value(exportOption), parser.value(formatOption), parser.isSet(offlineOption));
+    }
+
     auto auth = std::make_shared<AuthManager>();
 
     MainWindow w(auth);
+    if (parser.isSet(memoryBudgetOption))
+    {
+        w.setMemoryBudget(parser.value(memoryBudgetOption).toLongLong() * 1024 * 1024);
+    }
     w.show();
     return a.exec();
 }
@@ -20,8 +20,15 @@
 
 #include <QPropertyAnimation>
 
+#include <QMenu>
+#include <QListView>
+
 #include "tasklist.h"
 #include "oauthform.h"
+#include "refreshscheduler.h"
+#include "jsonitemstream.h"
+#include "smartviewmodel.h"
+#include "tasksapi.h"
 
 constexpr const char * tree_style = "QTreeView { "
                                     " show-decoration-selected: 0;"
@@ -57,6 +64,51 @@ MainWindow::MainWindow(std::shared_ptr<AuthManager> auth, QWidget *parent)
 
     mAuthManager = auth;
     mAuthPointer = auth->flow();
+    auto sortMenu = ui->menubar->addMenu("Sort lists");
+    const QPair<QString, int> sortRoles[] = {
+        {"By title", Qt::DisplayRole},
+        {"By open tasks", TreeModel::OpenCountRole},
+        {"By completed tasks", TreeModel::CompletedCountRole},
+        {"By last activity", TreeModel::LastActivityRole}
+    };
+    for (const auto & i: sortRoles)
+    {
+        sortMenu->addAction(i.first, this, [this, role = i.second]() {
+            if (mModel)
+            {
+                mModel->setSortRole(role);
+                mModel->sort(0, role == Qt::DisplayRole ? Qt::AscendingOrder : Qt::DescendingOrder);
+            }
+        });
+    }
+
+    auto viewsMenu = ui->menubar->addMenu("Views");
+    for (auto view: {TaskIndex::View::Overdue, TaskIndex::View::DueToday,
+                     TaskIndex::View::ThisWeek, TaskIndex::View::RecentlyCompleted})
+    {
+        viewsMenu->addAction(SmartViewModel::title(view), this, [this, view]() {
+            showSmartView(view);
+        });
+    }
+
+    mScheduler = new RefreshScheduler(mAuthPointer, this);
+    connect(mScheduler, &RefreshScheduler::taskListsChanged, this, &MainWindow::showTaskLists);
+    connect(mScheduler, &RefreshScheduler::tasksChanged, this, [this](const QString & taskListId,
+            const QVector<QByteArray> & items, bool complete) {
+        if (!mModel)
+        {
+            return;
+        }
+        if (complete)
+        {
+            mModel->setTasks(taskListId, items);
+        }
+        else
+        {
+            // Only the first page came with the poll
+            mModel->reloadTasks(taskListId);
+        }
+    });
     connect(mAuthPointer.get(), &QOAuth2AuthorizationCodeFlow::authorizeWithBrowser,
             this, &MainWindow::startAuthorizingRoutine);
     connect(mAuthPointer.get(), &QOAuth2AuthorizationCodeFlow::granted,
@@ -78,6 +130,15 @@ MainWindow::~MainWindow()
     delete ui;
 }
 
+void MainWindow::setMemoryBudget(qint64 bytes)
+{
+    mMemoryBudget = bytes;
+    if (mModel && mMemoryBudget > 0)
+    {
+        mModel->setMemoryBudget(mMemoryBudget);
+    }
+}
+
 void MainWindow::showEvent(QShowEvent */*event*/)
 {
     static std::once_flag authform_animation;
@@ -88,17 +149,31 @@ void MainWindow::showEvent(QShowEvent */*event*/)
     }
 }
 
-void MainWindow::createTaskListsView(QByteArray responseText)
+void MainWindow::createTaskListsView(const QJsonArray &taskLists)
 {
-    auto model = new TreeModel(QJsonDocument::fromJson(responseText).object().find("items")->toArray(),
-                               mAuthPointer,
-                               this);
     auto treeview = new QTreeView(this);
+    // Owned by the view so a replaced view takes its model with it
+    auto model = new TreeModel(taskLists, mAuthPointer, treeview);
+    connect(model, &TreeModel::tasksLoaded, mScheduler, &RefreshScheduler::setEtag);
+    if (mMemoryBudget > 0)
+    {
+        model->setMemoryBudget(mMemoryBudget);
+    }
+    mModel = model;
+    mScheduler->trackTaskLists(taskLists);
+    mScheduler->start();
+
     treeview->setModel(model);
+    connect(treeview, &QTreeView::expanded, model, &TreeModel::onExpanded);
+    connect(treeview, &QTreeView::collapsed, model, &TreeModel::onCollapsed);
     treeview->setIndentation(0);
     treeview->setAnimated(true);
     treeview->setStyleSheet(tree_style);
     treeview->setHeaderHidden(true);
+    // Blocks of tasks are reordered by dragging them within or between lists
+    treeview->setSelectionMode(QAbstractItemView::ExtendedSelection);
+    treeview->setDragDropMode(QAbstractItemView::InternalMove);
+    treeview->setDefaultDropAction(Qt::MoveAction);
 
     mCentralWidgetLayout->addWidget(treeview);
     if (mCentralWidgetLayout->count() > 1)
@@ -107,10 +182,45 @@ void MainWindow::createTaskListsView(QByteArray responseText)
     }
 }
 
+void MainWindow::showTaskLists(const QJsonArray &taskLists)
+{
+    if (mModel)
+    {
+        // Keep the live view and its expansion state, apply only what changed
+        mModel->setTaskLists(taskLists);
+        mScheduler->trackTaskLists(taskLists);
+    }
+    else
+    {
+        createTaskListsView(taskLists);
+    }
+}
+
+void MainWindow::showSmartView(TaskIndex::View view)
+{
+    if (!mModel)
+    {
+        return;
+    }
+    auto listView = new QListView();
+    listView->setAttribute(Qt::WA_DeleteOnClose);
+    listView->setWindowTitle(SmartViewModel::title(view));
+    listView->setModel(new SmartViewModel(mModel, view, listView));
+    listView->resize(width(), height());
+    listView->show();
+}
+
 void MainWindow::onGranted()
 {
     // TODO move GET lists to TreeModel
-    auto rest = mAuthPointer->get(QUrl("https://tasks.googleapis.com/tasks/v1/users/@me/lists"));
+    auto rest = mAuthPointer->get(QUrl(task_lists_url));
+    auto taskLists = std::make_shared<QJsonArray>();
+    auto stream = std::make_shared<JsonItemStream>([taskLists](const QByteArray & item) {
+        taskLists->append(QJsonDocument::fromJson(item).object());
+    });
+    connect(rest, &QNetworkReply::readyRead, [rest, stream]() {
+        stream->feed(rest->readAll());
+    });
     connect(rest, &QNetworkReply::finished, [=]() {
         if (rest->error() == QNetworkReply::AuthenticationRequiredError) {
             mAuthPointer->refreshAccessToken();
@@ -121,7 +231,9 @@ void MainWindow::onGranted()
             return;
         }
 
-        createTaskListsView(rest->readAll());
+        mScheduler->setEtag(QString{}, rest->rawHeader("ETag"));
+        stream->feed(rest->readAll());
+        showTaskLists(*taskLists);
     });
     connect(rest, &QNetworkReply::finished, rest, &QObject::deleteLater);
 }
@@ -4,16 +4,21 @@
 #include <memory>
 
 #include <QMainWindow>
+#include <QPointer>
 
 #include "authmanager.h"
+#include "taskindex.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
 QT_END_NAMESPACE
 
 class QStackedLayout;
+class QJsonArray;
 
 class OAuthForm;
+class RefreshScheduler;
+class TreeModel;
 
 class MainWindow : public QMainWindow
 {
@@ -23,6 +28,8 @@ public:
     MainWindow(std::shared_ptr<AuthManager> auth, QWidget *parent = nullptr);
     ~MainWindow();
 
+    void setMemoryBudget(qint64 bytes);
+
 protected:
     void showEvent(QShowEvent * event) override;
 
@@ -36,8 +43,14 @@ private:
 
     std::shared_ptr<AuthManager> mAuthManager;
     std::shared_ptr<QOAuth2AuthorizationCodeFlow> mAuthPointer;
+    RefreshScheduler * mScheduler;
+    // Owned by the tasks view, which slideToLeft() deletes
+    QPointer<TreeModel> mModel;
+    qint64 mMemoryBudget = 0;
     void startAuthorizingRoutine(const QUrl & url);
     void slideToLeft(QWidget * left, QWidget * right);
-    void createTaskListsView(QByteArray rest);
+    void showTaskLists(const QJsonArray & taskLists);
+    void showSmartView(TaskIndex::View view);
+    void createTaskListsView(const QJsonArray & taskLists);
 };
 #endif // MAINWINDOW_H
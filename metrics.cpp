@@ -0,0 +1,227 @@
+#include "metrics.h"
+
+#include <memory>
+
+#include <QElapsedTimer>
+#include <QNetworkReply>
+#include <QFile>
+
+#ifdef Q_OS_LINUX
+#include <unistd.h>
+#endif
+
+constexpr const char * metric_resident_bytes = "process_resident_memory_bytes";
+
+constexpr std::pair<const char *, const char *> metric_help[] = {
+    {metric_requests_in_flight, "Requests sent and not yet finished."},
+    {metric_requests_queued, "Polls that are due but held back by spacing or backoff."},
+    {metric_requests_total, "Finished requests by endpoint and HTTP status."},
+    {metric_request_duration, "Time from sending a request to its last byte."},
+    {metric_received_bytes, "Response bytes received."},
+    {metric_json_parse_seconds, "Time spent tokenizing JSON responses."},
+    {metric_json_parsed_bytes, "JSON bytes tokenized."},
+    {metric_token_refreshes, "OAuth access token refreshes requested."},
+    {metric_model_nodes, "Items per tree model, by kind."},
+    {metric_cache_lookups, "Offline cache lookups by result."},
+    {metric_resident_bytes, "Resident set size of the process."}
+};
+
+static QByteArray helpAndType(const QByteArray & name, const char * type)
+{
+    QByteArray out;
+    for (const auto & i: metric_help)
+    {
+        if (name == i.first)
+        {
+            out += "# HELP " + name + ' ' + i.second + '\n';
+            break;
+        }
+    }
+    return out + "# TYPE " + name + ' ' + type + '\n';
+}
+
+static QByteArray number(double value)
+{
+    return QByteArray::number(value, 'g', 15);
+}
+
+// Adds a label to an already rendered {...} set
+static QByteArray withLabel(const QByteArray & labels, const QByteArray & label)
+{
+    if (labels.isEmpty())
+    {
+        return '{' + label + '}';
+    }
+    return labels.left(labels.size() - 1) + ',' + label + '}';
+}
+
+// Label by path shape, so ids never leak into label values:
+// .../users/@me/lists, .../lists/<id>/tasks, .../lists/<id>/tasks/<id>[/move]
+static QByteArray endpoint(const QUrl & url)
+{
+    if (url.host() == "oauth2.googleapis.com")
+    {
+        return "token";
+    }
+    const auto path = url.path();
+    if (path.startsWith("/batch/"))
+    {
+        return "batch";
+    }
+    if (path.endsWith("/users/@me/lists"))
+    {
+        return "lists";
+    }
+
+    const auto segments = path.split('/', Qt::SkipEmptyParts);
+    const int lists = segments.indexOf("lists");
+    if (lists < 0 || segments.value(lists + 2) != "tasks")
+    {
+        return "other";
+    }
+    // Segments after "tasks"
+    const int rest = segments.size() - lists - 3;
+    if (rest == 0)
+    {
+        return "tasks";
+    }
+    if (rest == 1)
+    {
+        return "task";
+    }
+    if (rest == 2 && segments.last() == "move")
+    {
+        return "move";
+    }
+    return "other";
+}
+
+Metrics &Metrics::instance()
+{
+    static Metrics metrics;
+    return metrics;
+}
+
+QByteArray Metrics::labels(std::initializer_list<std::pair<const char *, QByteArray>> pairs)
+{
+    QByteArray out;
+    for (const auto & i: pairs)
+    {
+        auto value = i.second;
+        value.replace('\\', "\\\\").replace('"', "\\\"").replace('\n', "\\n");
+        out += (out.isEmpty() ? "{" : ",") + QByteArray(i.first) + "=\"" + value + '"';
+    }
+    return out.isEmpty() ? out : out + '}';
+}
+
+void Metrics::increment(const char *name, const QByteArray &labels, double by)
+{
+    mCounters[name][labels] += by;
+}
+
+void Metrics::addGauge(const char *name, const QByteArray &labels, double delta)
+{
+    mGauges[name][labels] += delta;
+}
+
+void Metrics::setGauge(const char *name, const QByteArray &labels, double value)
+{
+    mGauges[name][labels] = value;
+}
+
+void Metrics::removeGauge(const char *name, const QByteArray &labels)
+{
+    if (auto it = mGauges.find(name); it != mGauges.end())
+    {
+        it->remove(labels);
+    }
+}
+
+void Metrics::observe(const char *name, const QByteArray &labels, double value)
+{
+    auto & histogram = mHistograms[name][labels];
+    for (size_t i = 0; i < histogram_bounds.size(); ++i)
+    {
+        if (value <= histogram_bounds[i])
+        {
+            ++histogram.buckets[i];
+        }
+    }
+    ++histogram.count;
+    histogram.sum += value;
+}
+
+QByteArray Metrics::render() const
+{
+    QByteArray out;
+    for (auto it = mCounters.cbegin(); it != mCounters.cend(); ++it)
+    {
+        out += helpAndType(it.key(), "counter");
+        for (auto series = it->cbegin(); series != it->cend(); ++series)
+        {
+            out += it.key() + series.key() + ' ' + number(series.value()) + '\n';
+        }
+    }
+    for (auto it = mGauges.cbegin(); it != mGauges.cend(); ++it)
+    {
+        out += helpAndType(it.key(), "gauge");
+        for (auto series = it->cbegin(); series != it->cend(); ++series)
+        {
+            out += it.key() + series.key() + ' ' + number(series.value()) + '\n';
+        }
+    }
+    for (auto it = mHistograms.cbegin(); it != mHistograms.cend(); ++it)
+    {
+        out += helpAndType(it.key(), "histogram");
+        for (auto series = it->cbegin(); series != it->cend(); ++series)
+        {
+            for (size_t i = 0; i < histogram_bounds.size(); ++i)
+            {
+                out += it.key() + "_bucket" + withLabel(series.key(), "le=\"" + number(histogram_bounds[i]) + '"')
+                        + ' ' + QByteArray::number(series->buckets[i]) + '\n';
+            }
+            out += it.key() + "_bucket" + withLabel(series.key(), "le=\"+Inf\"") + ' ' + QByteArray::number(series->count) + '\n';
+            out += it.key() + "_sum" + series.key() + ' ' + number(series->sum) + '\n';
+            out += it.key() + "_count" + series.key() + ' ' + QByteArray::number(series->count) + '\n';
+        }
+    }
+
+#ifdef Q_OS_LINUX
+    // Second field of statm is the resident page count
+    if (QFile statm("/proc/self/statm"); statm.open(QIODevice::ReadOnly))
+    {
+        const auto fields = statm.readAll().split(' ');
+        if (fields.size() > 1)
+        {
+            out += helpAndType(metric_resident_bytes, "gauge");
+            out += QByteArray(metric_resident_bytes) + ' '
+                    + QByteArray::number(fields[1].toLongLong() * sysconf(_SC_PAGESIZE)) + '\n';
+        }
+    }
+#endif
+    return out;
+}
+
+QNetworkReply *MeteredNetworkAccessManager::createRequest(Operation op, const QNetworkRequest &request, QIODevice *outgoingData)
+{
+    auto reply = QNetworkAccessManager::createRequest(op, request, outgoingData);
+
+    const auto labels = Metrics::labels({{"endpoint", endpoint(request.url())}});
+    Metrics::instance().addGauge(metric_requests_in_flight, labels, 1);
+
+    QElapsedTimer timer;
+    timer.start();
+    auto received = std::make_shared<qint64>(0);
+    connect(reply, &QNetworkReply::downloadProgress, this, [labels, received](qint64 bytesReceived, qint64) {
+        Metrics::instance().increment(metric_received_bytes, labels, bytesReceived - *received);
+        *received = bytesReceived;
+    });
+    connect(reply, &QNetworkReply::finished, this, [reply, labels, timer]() {
+        auto & metrics = Metrics::instance();
+        const auto status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        metrics.addGauge(metric_requests_in_flight, labels, -1);
+        metrics.observe(metric_request_duration, labels, timer.nsecsElapsed() / 1e9);
+        metrics.increment(metric_requests_total, withLabel(labels, "code=\"" + QByteArray::number(status) + '"'));
+    });
+    return reply;
+}
@@ -0,0 +1,72 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <array>
+#include <initializer_list>
+#include <utility>
+
+#include <QByteArray>
+#include <QMap>
+#include <QNetworkAccessManager>
+
+constexpr const char * metric_requests_in_flight = "cutegoogletasks_http_requests_in_flight";
+constexpr const char * metric_requests_queued = "cutegoogletasks_http_requests_queued";
+constexpr const char * metric_requests_total = "cutegoogletasks_http_requests_total";
+constexpr const char * metric_request_duration = "cutegoogletasks_http_request_duration_seconds";
+constexpr const char * metric_received_bytes = "cutegoogletasks_http_received_bytes_total";
+constexpr const char * metric_json_parse_seconds = "cutegoogletasks_json_parse_seconds_total";
+constexpr const char * metric_json_parsed_bytes = "cutegoogletasks_json_parsed_bytes_total";
+constexpr const char * metric_token_refreshes = "cutegoogletasks_oauth_token_refreshes_total";
+constexpr const char * metric_model_nodes = "cutegoogletasks_model_nodes";
+constexpr const char * metric_cache_lookups = "cutegoogletasks_cache_lookups_total";
+
+// Process-wide counters, gauges and histograms, rendered in the Prometheus
+// text format. Everything is recorded and scraped on the GUI thread, so
+// there is no locking; recording is a map lookup and an add.
+class Metrics
+{
+public:
+    static Metrics & instance();
+
+    // {key="value",...}, values escaped
+    static QByteArray labels(std::initializer_list<std::pair<const char *, QByteArray>> pairs);
+
+    void increment(const char * name, const QByteArray & labels = {}, double by = 1);
+    void addGauge(const char * name, const QByteArray & labels, double delta);
+    void setGauge(const char * name, const QByteArray & labels, double value);
+    void removeGauge(const char * name, const QByteArray & labels);
+    void observe(const char * name, const QByteArray & labels, double value);
+
+    QByteArray render() const;
+
+private:
+    static constexpr std::array<double, 10> histogram_bounds{0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 30};
+
+    struct Histogram
+    {
+        std::array<quint64, histogram_bounds.size()> buckets{};
+        quint64 count = 0;
+        double sum = 0;
+    };
+
+    Metrics() = default;
+
+    QMap<QByteArray, QMap<QByteArray, double>> mCounters;
+    QMap<QByteArray, QMap<QByteArray, double>> mGauges;
+    QMap<QByteArray, QMap<QByteArray, Histogram>> mHistograms;
+};
+
+// Records in-flight count, latency, status and bytes of every request by
+// endpoint. Installed on the OAuth flow, so API and token traffic both go
+// through it.
+class MeteredNetworkAccessManager : public QNetworkAccessManager
+{
+public:
+    using QNetworkAccessManager::QNetworkAccessManager;
+
+protected:
+    QNetworkReply *createRequest(Operation op, const QNetworkRequest &request,
+                                 QIODevice *outgoingData = nullptr) override;
+};
+
+#endif // METRICS_H
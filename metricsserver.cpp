@@ -0,0 +1,81 @@
+#include "metricsserver.h"
+
+#include <QTcpSocket>
+#include <QTimer>
+
+#include "metrics.h"
+
+constexpr qint64 max_request_size = 8 * 1024;
+constexpr int request_timeout = 10 * 1000;
+constexpr const char * content_type = "text/plain; version=0.0.4; charset=utf-8";
+
+MetricsServer::MetricsServer(QObject *parent)
+    : QTcpServer(parent)
+{
+    connect(this, &QTcpServer::newConnection, this, &MetricsServer::onNewConnection);
+}
+
+bool MetricsServer::listen(quint16 port)
+{
+    return QTcpServer::listen(QHostAddress::LocalHost, port);
+}
+
+void MetricsServer::onNewConnection()
+{
+    while (auto socket = nextPendingConnection())
+    {
+        connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+        // A client that never completes its request, or never reads the
+        // answer, must not hold the socket forever. The timer dies with it.
+        auto timeout = new QTimer(socket);
+        timeout->setSingleShot(true);
+        connect(timeout, &QTimer::timeout, socket, [socket]() {
+            socket->abort();
+            socket->deleteLater();
+        });
+        timeout->start(request_timeout);
+        connect(socket, &QTcpSocket::readyRead, this, [this, socket]() {
+            respond(socket);
+        });
+    }
+}
+
+void MetricsServer::respond(QTcpSocket *socket)
+{
+    // Wait for the whole header block; a scraper never sends a body
+    if (!socket->canReadLine() || socket->peek(max_request_size).indexOf("\r\n\r\n") < 0)
+    {
+        if (socket->bytesAvailable() > max_request_size)
+        {
+            socket->abort();
+        }
+        return;
+    }
+    disconnect(socket, &QTcpSocket::readyRead, this, nullptr);
+
+    const auto requestLine = socket->readLine().trimmed().split(' ');
+    QByteArray status = "200 OK";
+    QByteArray body;
+    if (requestLine.size() < 2 || (requestLine[0] != "GET" && requestLine[0] != "HEAD"))
+    {
+        status = "405 Method Not Allowed";
+    }
+    else if (requestLine[1] != "/metrics" && !requestLine[1].startsWith("/metrics?"))
+    {
+        status = "404 Not Found";
+    }
+    else
+    {
+        body = Metrics::instance().render();
+    }
+
+    socket->write("HTTP/1.0 " + status + "\r\n"
+                  + "Content-Type: " + content_type + "\r\n"
+                  + "Content-Length: " + QByteArray::number(body.size()) + "\r\n"
+                  + "Connection: close\r\n\r\n");
+    if (requestLine.value(0) != "HEAD")
+    {
+        socket->write(body);
+    }
+    socket->disconnectFromHost();
+}
@@ -0,0 +1,25 @@
+#ifndef METRICSSERVER_H
+#define METRICSSERVER_H
+
+#include <QTcpServer>
+
+// Minimal HTTP/1.0 responder for Prometheus scrapes. Listens on loopback
+// only and answers GET /metrics; every connection serves one request and is
+// dropped if that takes longer than a few seconds.
+class MetricsServer : public QTcpServer
+{
+    Q_OBJECT
+
+public:
+    explicit MetricsServer(QObject *parent = nullptr);
+
+    bool listen(quint16 port);
+
+private slots:
+    void onNewConnection();
+
+private:
+    void respond(QTcpSocket * socket);
+};
+
+#endif // METRICSSERVER_H
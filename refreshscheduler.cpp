@@ -0,0 +1,289 @@
+#include "refreshscheduler.h"
+
+#include <limits>
+
+#include <QGuiApplication>
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRandomGenerator>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QOAuth2AuthorizationCodeFlow>
+#include <QDebug>
+
+#include "apicall.h"
+#include "tasklist.h"
+#include "tasksapi.h"
+
+constexpr qint64 initial_interval = 2 * 60 * 1000;
+constexpr qint64 min_interval = 15 * 1000;
+constexpr qint64 max_interval = 30 * 60 * 1000;
+constexpr qint64 focused_divisor = 4;
+constexpr double growth_factor = 1.5;
+
+constexpr qint64 dispatch_spacing = 750;
+constexpr qint64 min_backoff = 30 * 1000;
+constexpr qint64 max_backoff = 15 * 60 * 1000;
+
+// +-10% so targets sharing an interval drift apart instead of firing together
+static qint64 jittered(qint64 interval)
+{
+    const auto spread = static_cast<int>(interval / 5) + 1;
+    return interval - interval / 10 + QRandomGenerator::global()->bounded(spread);
+}
+
+RefreshScheduler::RefreshScheduler(std::shared_ptr<QOAuth2AuthorizationCodeFlow> flow, QObject *parent)
+    : QObject(parent)
+    , mFlow(flow)
+{
+    mTimer.setSingleShot(true);
+    connect(&mTimer, &QTimer::timeout, this, &RefreshScheduler::pollNext);
+
+    if (auto app = qobject_cast<QGuiApplication*>(QCoreApplication::instance()))
+    {
+        mFocused = app->applicationState() == Qt::ApplicationActive;
+        connect(app, &QGuiApplication::applicationStateChanged,
+                this, &RefreshScheduler::onApplicationStateChanged);
+    }
+
+    mTargets.insert(QString{}, Target{QUrl(task_lists_url), {}, initial_interval, 0});
+    schedule(mTargets[QString{}], QDateTime::currentMSecsSinceEpoch());
+}
+
+void RefreshScheduler::trackTaskLists(const QJsonArray &taskLists)
+{
+    QStringList ids;
+    for (const auto & i: taskLists)
+    {
+        ids << i.toObject()["id"].toString();
+    }
+
+    for (auto it = mTargets.begin(); it != mTargets.end();)
+    {
+        if (!it.key().isEmpty() && !ids.contains(it.key()))
+        {
+            it = mTargets.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    // Stagger first polls of new lists across one interval
+    const auto now = QDateTime::currentMSecsSinceEpoch();
+    for (int i = 0; i < ids.size(); ++i)
+    {
+        if (mTargets.contains(ids[i]))
+        {
+            continue;
+        }
+        Target target{TaskList::tasksUrl(ids[i]), {}, initial_interval, 0};
+        target.nextPoll = now + effectiveInterval(target) * (i + 1) / (ids.size() + 1);
+        mTargets.insert(ids[i], target);
+    }
+    armTimer();
+}
+
+void RefreshScheduler::setEtag(const QString &taskListId, const QByteArray &etag)
+{
+    if (auto it = mTargets.find(taskListId); it != mTargets.end())
+    {
+        it->etag = etag;
+    }
+}
+
+void RefreshScheduler::start()
+{
+    mRunning = true;
+    armTimer();
+}
+
+void RefreshScheduler::stop()
+{
+    mRunning = false;
+    mTimer.stop();
+    Metrics::instance().setGauge(metric_requests_queued, {}, 0);
+}
+
+void RefreshScheduler::onApplicationStateChanged(Qt::ApplicationState state)
+{
+    const bool focused = state == Qt::ApplicationActive;
+    if (focused == mFocused)
+    {
+        return;
+    }
+    mFocused = focused;
+
+    if (mFocused)
+    {
+        // Pull pending polls in to the focused cadence, never push them out
+        const auto now = QDateTime::currentMSecsSinceEpoch();
+        for (auto & target: mTargets)
+        {
+            target.nextPoll = qMin(target.nextPoll, now + jittered(effectiveInterval(target)));
+        }
+    }
+    armTimer();
+}
+
+void RefreshScheduler::pollNext()
+{
+    const auto now = QDateTime::currentMSecsSinceEpoch();
+    if (!mRunning || now < mBackoffUntil)
+    {
+        armTimer();
+        return;
+    }
+
+    QString dueKey;
+    qint64 dueTime = std::numeric_limits<qint64>::max();
+    for (auto it = mTargets.cbegin(); it != mTargets.cend(); ++it)
+    {
+        if (!it->inFlight && it->nextPoll < dueTime)
+        {
+            dueKey = it.key();
+            dueTime = it->nextPoll;
+        }
+    }
+
+    if (dueTime <= now)
+    {
+        mLastDispatch = now;
+        poll(dueKey);
+    }
+    armTimer();
+}
+
+void RefreshScheduler::poll(const QString &key)
+{
+    auto & target = mTargets[key];
+
+    QNetworkRequest request(target.url);
+    if (!target.etag.isEmpty())
+    {
+        request.setRawHeader("If-None-Match", target.etag);
+    }
+
+    target.inFlight = true;
+    // Items are split off as they arrive, so a changed list never needs a
+    // DOM of its whole body
+    auto items = std::make_shared<QVector<QByteArray>>();
+    ApiCall::send(*mFlow, request, mPolls.token(), [](QNetworkAccessManager & manager, const QNetworkRequest & request) {
+        return manager.get(request);
+    }).onItem([items](const QByteArray & item) {
+        items->append(item);
+    }).then([this, key, items](const ApiResponse & response) {
+        onReply(key, response, *items);
+    });
+}
+
+void RefreshScheduler::onReply(const QString &key, const ApiResponse &response, const QVector<QByteArray> &items)
+{
+    auto reply = response.reply;
+    auto it = mTargets.find(key);
+    if (it == mTargets.end())
+    {
+        // The list was deleted while the poll was in flight
+        return;
+    }
+    auto & target = *it;
+    target.inFlight = false;
+
+    const auto now = QDateTime::currentMSecsSinceEpoch();
+    const auto status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+
+    if (status == 429 || status >= 500)
+    {
+        mBackoff = mBackoff ? qMin(mBackoff * 2, max_backoff) : min_backoff;
+        const auto retryAfter = reply->rawHeader("Retry-After").toLongLong() * 1000;
+        mBackoffUntil = now + qMax(mBackoff, retryAfter);
+        target.nextPoll = mBackoffUntil + jittered(dispatch_spacing);
+        armTimer();
+        return;
+    }
+    if (status == 401)
+    {
+        mFlow->refreshAccessToken();
+        target.nextPoll = now + min_backoff;
+        armTimer();
+        return;
+    }
+    if (!response.ok && status != 304)
+    {
+        qWarning() << "Poll failed:" << target.url << reply->errorString();
+        schedule(target, now);
+        return;
+    }
+
+    mBackoff = 0;
+    const auto etag = reply->rawHeader("ETag");
+    if (status == 304 || (!etag.isEmpty() && etag == target.etag))
+    {
+        target.interval = qMin(max_interval, static_cast<qint64>(target.interval * growth_factor));
+        schedule(target, now);
+        return;
+    }
+
+    if (!target.etag.isEmpty())
+    {
+        target.interval = qMax(min_interval, target.interval / 2);
+    }
+    target.etag = etag;
+    schedule(target, now);
+
+    if (key.isEmpty())
+    {
+        QJsonArray taskLists;
+        for (const auto & i: items)
+        {
+            taskLists.append(QJsonDocument::fromJson(i).object());
+        }
+        trackTaskLists(taskLists);
+        emit taskListsChanged(taskLists);
+    }
+    else
+    {
+        emit tasksChanged(key, items, response.field("nextPageToken").isEmpty());
+    }
+}
+
+void RefreshScheduler::schedule(Target &target, qint64 now)
+{
+    target.nextPoll = now + jittered(effectiveInterval(target));
+    armTimer();
+}
+
+void RefreshScheduler::armTimer()
+{
+    if (!mRunning)
+    {
+        return;
+    }
+
+    const auto now = QDateTime::currentMSecsSinceEpoch();
+    qint64 due = std::numeric_limits<qint64>::max();
+    int queued = 0;
+    for (const auto & target: qAsConst(mTargets))
+    {
+        if (!target.inFlight)
+        {
+            due = qMin(due, target.nextPoll);
+            queued += target.nextPoll <= now;
+        }
+    }
+    Metrics::instance().setGauge(metric_requests_queued, {}, queued);
+    if (due == std::numeric_limits<qint64>::max())
+    {
+        return;
+    }
+
+    due = qMax(due, qMax(mLastDispatch + dispatch_spacing, mBackoffUntil));
+    mTimer.start(static_cast<int>(qMax<qint64>(0, due - now)));
+}
+
+qint64 RefreshScheduler::effectiveInterval(const Target &target) const
+{
+    return mFocused ? qMax(min_interval, target.interval / focused_divisor) : target.interval;
+}
@@ -0,0 +1,77 @@
+#ifndef REFRESHSCHEDULER_H
+#define REFRESHSCHEDULER_H
+
+#include <memory>
+
+#include <QObject>
+#include <QHash>
+#include <QTimer>
+#include <QUrl>
+#include <QJsonArray>
+#include <QVector>
+
+#include "cancellation.h"
+
+class QNetworkReply;
+class QOAuth2AuthorizationCodeFlow;
+struct ApiResponse;
+
+// Polls the task lists endpoint and every task list with If-None-Match.
+// Each target learns its own interval: it halves when a change is seen and
+// grows while the server keeps answering 304. Polls run faster while the
+// application is active, back off globally on 429/5xx and are dispatched
+// one at a time with jitter so they never arrive in bursts.
+class RefreshScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit RefreshScheduler(std::shared_ptr<QOAuth2AuthorizationCodeFlow> flow, QObject *parent = nullptr);
+
+    void trackTaskLists(const QJsonArray & taskLists);
+    // Empty id stands for the task lists endpoint itself
+    void setEtag(const QString & taskListId, const QByteArray & etag);
+
+    void start();
+    void stop();
+
+signals:
+    void taskListsChanged(const QJsonArray & taskLists);
+    // items are the raw objects of the first page; complete is false when
+    // more pages follow and the list has to be fetched in full
+    void tasksChanged(const QString & taskListId, const QVector<QByteArray> & items, bool complete);
+
+private slots:
+    void onApplicationStateChanged(Qt::ApplicationState state);
+    void pollNext();
+
+private:
+    struct Target
+    {
+        QUrl url;
+        QByteArray etag;
+        qint64 interval;
+        qint64 nextPoll;
+        bool inFlight = false;
+    };
+
+    void poll(const QString & key);
+    void onReply(const QString & key, const ApiResponse & response, const QVector<QByteArray> & items);
+    void schedule(Target & target, qint64 now);
+    void armTimer();
+    qint64 effectiveInterval(const Target & target) const;
+
+    std::shared_ptr<QOAuth2AuthorizationCodeFlow> mFlow;
+    QHash<QString, Target> mTargets;
+    QTimer mTimer;
+    // Polls in flight die with the scheduler
+    CancellationSource mPolls;
+
+    bool mRunning = false;
+    bool mFocused = true;
+    qint64 mBackoff = 0;
+    qint64 mBackoffUntil = 0;
+    qint64 mLastDispatch = 0;
+};
+
+#endif // REFRESHSCHEDULER_H
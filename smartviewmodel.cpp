@@ -0,0 +1,68 @@
+#include "smartviewmodel.h"
+
+#include <QLocale>
+
+#include "tasklist.h"
+
+SmartViewModel::SmartViewModel(TreeModel *source, TaskIndex::View view, QObject *parent)
+    : QAbstractListModel(parent)
+    , mSource(source)
+    , mView(view)
+{
+    connect(source, &TreeModel::taskIndexChanged, this, &SmartViewModel::refresh);
+    refresh();
+}
+
+QString SmartViewModel::title(TaskIndex::View view)
+{
+    switch (view)
+    {
+    case TaskIndex::View::Overdue:
+        return "Overdue";
+    case TaskIndex::View::DueToday:
+        return "Due today";
+    case TaskIndex::View::ThisWeek:
+        return "This week";
+    case TaskIndex::View::RecentlyCompleted:
+        return "Recently completed";
+    }
+    return {};
+}
+
+int SmartViewModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : mEntries.size();
+}
+
+QVariant SmartViewModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= mEntries.size())
+        return QVariant();
+
+    const auto & entry = mEntries[index.row()];
+    switch (role)
+    {
+    case Qt::DisplayRole:
+        return entry.title;
+    case Qt::ToolTipRole:
+    {
+        const bool completed = mView == TaskIndex::View::RecentlyCompleted;
+        return QString(completed ? "Completed %1" : "Due %1")
+                .arg(completed ? QLocale().toString(entry.completed.toLocalTime(), QLocale::ShortFormat)
+                               : QLocale().toString(entry.due.date(), QLocale::ShortFormat));
+    }
+    default:
+        return QVariant();
+    }
+}
+
+void SmartViewModel::refresh()
+{
+    if (!mSource)
+    {
+        return;
+    }
+    beginResetModel();
+    mEntries = mSource->taskIndex().query(mView);
+    endResetModel();
+}
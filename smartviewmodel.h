@@ -0,0 +1,33 @@
+#ifndef SMARTVIEWMODEL_H
+#define SMARTVIEWMODEL_H
+
+#include <QAbstractListModel>
+#include <QPointer>
+
+#include "taskindex.h"
+
+class TreeModel;
+
+// Flat, read-only view over tasks of every list, answered from TaskIndex
+class SmartViewModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    SmartViewModel(TreeModel * source, TaskIndex::View view, QObject *parent = nullptr);
+
+    static QString title(TaskIndex::View view);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role) const override;
+
+public slots:
+    void refresh();
+
+private:
+    QPointer<TreeModel> mSource;
+    TaskIndex::View mView;
+    QVector<TaskIndex::Entry> mEntries;
+};
+
+#endif // SMARTVIEWMODEL_H
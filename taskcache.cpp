@@ -0,0 +1,114 @@
+#include "taskcache.h"
+
+#include <utility>
+
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+
+#include "metrics.h"
+
+static QByteArray jsonString(const QString & value)
+{
+    const auto array = QJsonDocument{QJsonArray{value}}.toJson(QJsonDocument::Compact);
+    return array.mid(1, array.size() - 2);
+}
+
+TaskCache::Writer::Writer(const QString &fileName, const QString &taskListId, const QString &title):
+    mFile(fileName)
+{
+    if (mFile.open(QIODevice::WriteOnly))
+    {
+        mFile.write("{\"id\":" + jsonString(taskListId) + ",\"title\":" + jsonString(title) + ",\"items\":[");
+    }
+}
+
+void TaskCache::Writer::append(const QByteArray &item)
+{
+    if (!std::exchange(mEmpty, false))
+    {
+        mFile.write(",");
+    }
+    mFile.write(item);
+}
+
+bool TaskCache::Writer::commit()
+{
+    mFile.write("]}");
+    return mFile.commit();
+}
+
+TaskCache::TaskCache(Contents contents):
+    mDirectory(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)
+               .append(contents == Contents::Open ? "/cache" : "/cache/completed"))
+{
+    QDir().mkpath(mDirectory);
+}
+
+std::unique_ptr<TaskCache::Writer> TaskCache::writer(const QString &taskListId, const QString &title) const
+{
+    return std::make_unique<Writer>(fileName(taskListId), taskListId, title);
+}
+
+void TaskCache::store(const QString &taskListId, const QString &title, const QJsonArray &tasks)
+{
+    QJsonObject object;
+    object["id"] = taskListId;
+    object["title"] = title;
+    object["items"] = tasks;
+
+    if (QSaveFile cacheFile(fileName(taskListId)); cacheFile.open(QIODevice::WriteOnly))
+    {
+        cacheFile.write(QJsonDocument{object}.toJson(QJsonDocument::Compact));
+        cacheFile.commit();
+    }
+}
+
+bool TaskCache::load(const QString &taskListId, QJsonArray &tasks, QString *title) const
+{
+    if (QFile cacheFile(fileName(taskListId)); cacheFile.open(QIODevice::ReadOnly))
+    {
+        if (auto doc = QJsonDocument::fromJson(cacheFile.readAll()); doc.isObject())
+        {
+            tasks = doc.object()["items"].toArray();
+            if (title)
+            {
+                *title = doc.object()["title"].toString();
+            }
+            Metrics::instance().increment(metric_cache_lookups, Metrics::labels({{"result", "hit"}}));
+            return true;
+        }
+    }
+    Metrics::instance().increment(metric_cache_lookups, Metrics::labels({{"result", "miss"}}));
+    return false;
+}
+
+void TaskCache::remove(const QString &taskListId)
+{
+    QFile::remove(fileName(taskListId));
+}
+
+QStringList TaskCache::taskListIds() const
+{
+    QStringList ids;
+    for (const auto & i: QDir(mDirectory).entryInfoList({"*.json"}, QDir::Files))
+    {
+        ids << i.completeBaseName();
+    }
+    return ids;
+}
+
+QString TaskCache::directory() const
+{
+    return mDirectory;
+}
+
+QString TaskCache::fileName(const QString &taskListId) const
+{
+    // List ids are URL-safe base64, fine as file names
+    return mDirectory + "/" + taskListId + ".json";
+}
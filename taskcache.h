@@ -0,0 +1,57 @@
+#ifndef TASKCACHE_H
+#define TASKCACHE_H
+
+#include <memory>
+
+#include <QString>
+#include <QStringList>
+#include <QJsonArray>
+#include <QSaveFile>
+
+// On-disk snapshot of each task list's items, one JSON file per list.
+// TreeModel writes through on every refresh and reads back when an evicted
+// list is expanded again.
+class TaskCache
+{
+public:
+    // Open tasks, or the completed ones a list's section has loaded so far;
+    // each kind has its own directory
+    enum class Contents
+    {
+        Open,
+        Completed
+    };
+
+    // Writes a list's file item by item while its response is still arriving
+    class Writer
+    {
+    public:
+        Writer(const QString & fileName, const QString & taskListId, const QString & title);
+
+        void append(const QByteArray & item);
+        bool commit();
+
+    private:
+        QSaveFile mFile;
+        bool mEmpty = true;
+    };
+
+    explicit TaskCache(Contents contents = Contents::Open);
+
+    std::unique_ptr<Writer> writer(const QString & taskListId, const QString & title) const;
+
+    void store(const QString & taskListId, const QString & title, const QJsonArray & tasks);
+    bool load(const QString & taskListId, QJsonArray & tasks, QString * title = nullptr) const;
+    void remove(const QString & taskListId);
+
+    QStringList taskListIds() const;
+
+    QString directory() const;
+
+private:
+    QString fileName(const QString & taskListId) const;
+
+    QString mDirectory;
+};
+
+#endif // TASKCACHE_H
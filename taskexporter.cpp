@@ -0,0 +1,268 @@
+#include "taskexporter.h"
+
+#include <QSet>
+#include <QTimer>
+#include <QUrlQuery>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QNetworkReply>
+#include <QOAuth2AuthorizationCodeFlow>
+#include <QDebug>
+
+#include "tasklist.h"
+#include "taskcache.h"
+#include "jsonitemstream.h"
+#include "tasksapi.h"
+
+constexpr const char * page_size = "100";
+constexpr int max_streams = 4;
+
+constexpr const char * csv_columns[] = {
+    "id", "title", "status", "due", "completed", "updated", "parent", "position", "notes"
+};
+
+static QByteArray csvField(const QString & value)
+{
+    auto utf8 = value.toUtf8();
+    if (utf8.contains(',') || utf8.contains('"') || utf8.contains('\n') || utf8.contains('\r'))
+    {
+        utf8.replace("\"", "\"\"");
+        utf8.prepend('"');
+        utf8.append('"');
+    }
+    return utf8;
+}
+
+static QByteArray jsonString(const QString & value)
+{
+    const auto array = QJsonDocument{QJsonArray{value}}.toJson(QJsonDocument::Compact);
+    return array.mid(1, array.size() - 2);
+}
+
+TaskExporter::TaskExporter(std::shared_ptr<QOAuth2AuthorizationCodeFlow> flow, QObject *parent)
+    : QObject(parent)
+    , mFlow(flow)
+{
+
+}
+
+bool TaskExporter::start(const QString &fileName, Format format, Source source)
+{
+    mFile.setFileName(fileName);
+    if (!mFile.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        qCritical() << "Cannot open" << fileName << mFile.errorString();
+        return false;
+    }
+    mFormat = format;
+
+    if (mFormat == Format::Csv)
+    {
+        QByteArray header = "tasklist_id,tasklist_title";
+        for (auto column: csv_columns)
+        {
+            header.append(',').append(column);
+        }
+        mFile.write(header.append('\n'));
+    }
+
+    if (source == Source::Snapshot)
+    {
+        mSnapshotIds = TaskCache().taskListIds();
+        QTimer::singleShot(0, this, &TaskExporter::exportNextSnapshot);
+    }
+    else
+    {
+        fetchTaskLists({});
+    }
+    return true;
+}
+
+void TaskExporter::fetchTaskLists(const QString &pageToken)
+{
+    QUrl url(task_lists_url);
+    QUrlQuery query;
+    query.addQueryItem("maxResults", page_size);
+    if (!pageToken.isEmpty())
+    {
+        query.addQueryItem("pageToken", pageToken);
+    }
+    url.setQuery(query);
+
+    auto reply = mFlow->get(url);
+    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
+        reply->deleteLater();
+        if (failed(reply))
+        {
+            return;
+        }
+
+        const auto page = QJsonDocument::fromJson(reply->readAll()).object();
+        if (const auto next = page["nextPageToken"].toString(); !next.isEmpty())
+        {
+            fetchTaskLists(next);
+        }
+        else
+        {
+            mTaskListsDone = true;
+        }
+        for (const auto & i: page["items"].toArray())
+        {
+            const auto taskList = i.toObject();
+            mPendingTaskLists.enqueue({taskList["id"].toString(), taskList["title"].toString()});
+        }
+        pumpStreams();
+    });
+}
+
+void TaskExporter::fetchTasks(const TaskListRef &taskList, const QString &pageToken,
+                              std::shared_ptr<int> pagesInFlight)
+{
+    ++*pagesInFlight;
+    auto url = TaskList::tasksUrl(taskList.first);
+    QUrlQuery query;
+    query.addQueryItem("maxResults", page_size);
+    query.addQueryItem("showCompleted", "true");
+    query.addQueryItem("showHidden", "true");
+    if (!pageToken.isEmpty())
+    {
+        query.addQueryItem("pageToken", pageToken);
+    }
+    url.setQuery(query);
+
+    auto reply = mFlow->get(url);
+    auto stream = std::make_shared<JsonItemStream>([this, taskList](const QByteArray & item) {
+        writeTask(taskList, item);
+    });
+    // The API sends nextPageToken ahead of the items, so the next page is
+    // usually requested before this one has finished downloading
+    auto requestedNext = std::make_shared<bool>(false);
+    auto requestNext = [this, taskList, stream, requestedNext, pagesInFlight]() {
+        if (const auto next = stream->field("nextPageToken"); !next.isEmpty() && !*requestedNext)
+        {
+            *requestedNext = true;
+            fetchTasks(taskList, next, pagesInFlight);
+        }
+    };
+    connect(reply, &QNetworkReply::readyRead, this, [this, reply, stream, requestNext]() {
+        if (mFinished || !stream->feed(reply->readAll()))
+        {
+            reply->abort();
+            return;
+        }
+        requestNext();
+    });
+    connect(reply, &QNetworkReply::finished, this, [this, reply, stream, requestNext, pagesInFlight]() {
+        reply->deleteLater();
+        if (failed(reply))
+        {
+            return;
+        }
+        stream->feed(reply->readAll());
+        requestNext();
+        // The last page can finish before earlier ones; the list is done
+        // only once none of its pages is downloading any more
+        if (--*pagesInFlight == 0)
+        {
+            --mActiveStreams;
+            pumpStreams();
+        }
+    });
+}
+
+void TaskExporter::exportNextSnapshot()
+{
+    if (mSnapshotIds.isEmpty())
+    {
+        finish(true);
+        return;
+    }
+
+    // One list resident at a time. Completed tasks are only there as far as
+    // the app loaded them; a task completed here is newer in that cache.
+    TaskListRef taskList{mSnapshotIds.takeFirst(), {}};
+    QSet<QString> written;
+    if (QJsonArray tasks; TaskCache(TaskCache::Contents::Completed).load(taskList.first, tasks, &taskList.second))
+    {
+        for (const auto & i: tasks)
+        {
+            written.insert(i.toObject()["id"].toString());
+            writeTask(taskList, QJsonDocument{i.toObject()}.toJson(QJsonDocument::Compact));
+        }
+    }
+    if (QJsonArray tasks; TaskCache().load(taskList.first, tasks, &taskList.second))
+    {
+        for (const auto & i: tasks)
+        {
+            if (!written.contains(i.toObject()["id"].toString()))
+            {
+                writeTask(taskList, QJsonDocument{i.toObject()}.toJson(QJsonDocument::Compact));
+            }
+        }
+    }
+    QTimer::singleShot(0, this, &TaskExporter::exportNextSnapshot);
+}
+
+void TaskExporter::pumpStreams()
+{
+    while (mActiveStreams < max_streams && !mPendingTaskLists.isEmpty())
+    {
+        ++mActiveStreams;
+        fetchTasks(mPendingTaskLists.dequeue(), {}, std::make_shared<int>(0));
+    }
+    if (mTaskListsDone && !mActiveStreams)
+    {
+        finish(true);
+    }
+}
+
+void TaskExporter::writeTask(const TaskListRef &taskList, const QByteArray &item)
+{
+    QByteArray record;
+    if (mFormat == Format::Jsonl)
+    {
+        // Splice the list id into the raw item instead of re-serializing it.
+        // Items arrive compact (prettyPrint=false); anything else is
+        // re-serialized, since a record has to fit on one line.
+        const auto member = "\"tasklist\":" + jsonString(taskList.first);
+        record = item.contains('\n') ? QJsonDocument::fromJson(item).toJson(QJsonDocument::Compact) : item;
+        record.insert(1, item.size() > 2 ? member + ',' : member);
+    }
+    else
+    {
+        const auto task = QJsonDocument::fromJson(item).object();
+        record = csvField(taskList.first) + ',' + csvField(taskList.second);
+        for (auto column: csv_columns)
+        {
+            record.append(',').append(csvField(task[column].toString()));
+        }
+    }
+    mFile.write(record.append('\n'));
+    ++mTasksWritten;
+}
+
+void TaskExporter::finish(bool success)
+{
+    if (mFinished)
+    {
+        return;
+    }
+    mFinished = true;
+    mFile.close();
+    emit finished(success, mTasksWritten);
+}
+
+bool TaskExporter::failed(QNetworkReply *reply)
+{
+    if (mFinished)
+    {
+        return true;
+    }
+    if (reply->error() != QNetworkReply::NoError)
+    {
+        qCritical() << "Export failed:" << reply->url() << reply->errorString();
+        finish(false);
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,71 @@
+#ifndef TASKEXPORTER_H
+#define TASKEXPORTER_H
+
+#include <memory>
+
+#include <QObject>
+#include <QFile>
+#include <QQueue>
+#include <QPair>
+#include <QStringList>
+#include <QJsonObject>
+
+class QNetworkReply;
+class QOAuth2AuthorizationCodeFlow;
+
+// Dumps every task of the account to disk without building a TreeModel.
+// Pages are written as soon as they arrive and dropped right after, so memory
+// stays at a few pages regardless of account size. The next page of a list is
+// requested before the current one is written, and several lists stream at
+// once, so the writer is never the bottleneck.
+class TaskExporter : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum class Format
+    {
+        Jsonl,
+        Csv
+    };
+
+    enum class Source
+    {
+        Network,
+        Snapshot
+    };
+
+    explicit TaskExporter(std::shared_ptr<QOAuth2AuthorizationCodeFlow> flow, QObject *parent = nullptr);
+
+    bool start(const QString & fileName, Format format, Source source);
+
+signals:
+    void finished(bool success, qint64 tasksWritten);
+
+private:
+    using TaskListRef = QPair<QString, QString>; // id, title
+
+    void fetchTaskLists(const QString & pageToken);
+    // pagesInFlight counts the list's pages requested but not yet finished;
+    // they overlap and may finish in any order
+    void fetchTasks(const TaskListRef & taskList, const QString & pageToken,
+                    std::shared_ptr<int> pagesInFlight);
+    void exportNextSnapshot();
+    void pumpStreams();
+    void writeTask(const TaskListRef & taskList, const QByteArray & item);
+    void finish(bool success);
+    bool failed(QNetworkReply * reply);
+
+    std::shared_ptr<QOAuth2AuthorizationCodeFlow> mFlow;
+    QFile mFile;
+    Format mFormat = Format::Jsonl;
+
+    QQueue<TaskListRef> mPendingTaskLists;
+    QStringList mSnapshotIds;
+    int mActiveStreams = 0;
+    bool mTaskListsDone = false;
+    bool mFinished = false;
+    qint64 mTasksWritten = 0;
+};
+
+#endif // TASKEXPORTER_H
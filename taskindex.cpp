@@ -0,0 +1,102 @@
+#include "taskindex.h"
+
+#include <algorithm>
+
+#include "tasklist.h"
+
+void TaskIndex::update(const Task &task, const QString &taskListId)
+{
+    if (const auto location = mLocations.find(task.key()); location != mLocations.end())
+    {
+        erase(location);
+    }
+
+    const bool completed = task.getStatus() == "completed";
+    const auto when = completed ? task.getCompleted() : task.getDue();
+    if (!when.isValid())
+    {
+        return;
+    }
+
+    const Key key{when, task.key()};
+    (completed ? mCompletedByTime : mOpenByDue).insert(key, Entry{task.key(), taskListId, task.title(), task.getDue(), task.getCompleted()});
+    mLocations.insert(task.key(), Location{key, completed});
+    mTaskLists[taskListId].insert(task.key());
+}
+
+void TaskIndex::remove(const QString &taskId, const QString &taskListId)
+{
+    const auto location = mLocations.find(taskId);
+    if (location == mLocations.end() || !mTaskLists.value(taskListId).contains(taskId))
+    {
+        return;
+    }
+    erase(location);
+}
+
+void TaskIndex::erase(QHash<QString, Location>::iterator location)
+{
+    const auto taskId = location.key();
+    auto & index = location->completed ? mCompletedByTime : mOpenByDue;
+    if (const auto entry = index.find(location->key); entry != index.end())
+    {
+        mTaskLists[entry->taskListId].remove(taskId);
+        index.erase(entry);
+    }
+    mLocations.erase(location);
+}
+
+void TaskIndex::removeTaskList(const QString &taskListId)
+{
+    for (const auto & taskId: mTaskLists.take(taskListId))
+    {
+        if (const auto location = mLocations.find(taskId); location != mLocations.end())
+        {
+            (location->completed ? mCompletedByTime : mOpenByDue).remove(location->key);
+            mLocations.erase(location);
+        }
+    }
+}
+
+void TaskIndex::removeTasks(const QString &taskListId, bool completed)
+{
+    for (const auto & taskId: mTaskLists.value(taskListId))
+    {
+        if (const auto location = mLocations.find(taskId); location != mLocations.end() && location->completed == completed)
+        {
+            erase(location);
+        }
+    }
+}
+
+QVector<TaskIndex::Entry> TaskIndex::query(View view, const QDateTime &now) const
+{
+    // Due dates carry no time of day, the API sends them as UTC midnight
+    const QDateTime today(now.date(), QTime(0, 0), Qt::UTC);
+
+    QVector<Entry> result;
+    auto collect = [&result](QMap<Key, Entry>::const_iterator from, QMap<Key, Entry>::const_iterator to) {
+        for (; from != to; ++from)
+        {
+            result.append(*from);
+        }
+    };
+
+    switch (view)
+    {
+    case View::Overdue:
+        collect(mOpenByDue.cbegin(), mOpenByDue.lowerBound({today, {}}));
+        break;
+    case View::DueToday:
+        collect(mOpenByDue.lowerBound({today, {}}), mOpenByDue.lowerBound({today.addDays(1), {}}));
+        break;
+    case View::ThisWeek:
+        collect(mOpenByDue.lowerBound({today, {}}), mOpenByDue.lowerBound({today.addDays(7), {}}));
+        break;
+    case View::RecentlyCompleted:
+        collect(mCompletedByTime.lowerBound({now.addDays(-7), {}}), mCompletedByTime.cend());
+        std::reverse(result.begin(), result.end());
+        break;
+    }
+    return result;
+}
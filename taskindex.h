@@ -0,0 +1,65 @@
+#ifndef TASKINDEX_H
+#define TASKINDEX_H
+
+#include <QDateTime>
+#include <QHash>
+#include <QMap>
+#include <QPair>
+#include <QSet>
+#include <QString>
+#include <QVector>
+
+class Task;
+
+// Ordered secondary indexes over the tasks of all lists: open tasks by due
+// date and completed tasks by completion time. TreeModel updates them as
+// tasks change, so every smart view is a range lookup. Entries keep what a
+// view row needs, which lets them outlive eviction of their list's payload.
+class TaskIndex
+{
+public:
+    enum class View
+    {
+        Overdue,
+        DueToday,
+        ThisWeek,
+        RecentlyCompleted
+    };
+
+    struct Entry
+    {
+        QString taskId;
+        QString taskListId;
+        QString title;
+        QDateTime due;
+        QDateTime completed;
+    };
+
+    void update(const Task & task, const QString & taskListId);
+    // Leaves the entry alone if the task has moved on to another list
+    void remove(const QString & taskId, const QString & taskListId);
+    void removeTaskList(const QString & taskListId);
+    // Only the list's completed entries, or only its open ones
+    void removeTasks(const QString & taskListId, bool completed);
+
+    QVector<Entry> query(View view, const QDateTime & now = QDateTime::currentDateTime()) const;
+
+private:
+    // Task id breaks ties so every key is unique
+    using Key = QPair<QDateTime, QString>;
+
+    struct Location
+    {
+        Key key;
+        bool completed;
+    };
+
+    void erase(QHash<QString, Location>::iterator location);
+
+    QMap<Key, Entry> mOpenByDue;
+    QMap<Key, Entry> mCompletedByTime;
+    QHash<QString, Location> mLocations;
+    QHash<QString, QSet<QString>> mTaskLists;
+};
+
+#endif // TASKINDEX_H
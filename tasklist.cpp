@@ -1,13 +1,41 @@
 #include "tasklist.h"
 
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
 #include <QVariant>
 #include <QJsonArray>
+#include <QtNetwork/QNetworkAccessManager>
 #include <QtNetwork/QNetworkReply>
 #include <QDebug>
 #include <QJsonDocument>
 #include <QSize>
 #include <QBrush>
 #include <QIcon>
+#include <QUrlQuery>
+#include <QSet>
+#include <QHash>
+#include <QLocale>
+#include <QMimeData>
+#include <QDataStream>
+#include <QHttpMultiPart>
+
+#include "apicall.h"
+#include "metrics.h"
+#include "tasksapi.h"
+
+constexpr qint64 default_memory_budget = 16 * 1024 * 1024;
+constexpr const char * node_kinds[] = {"task_list", "task", "resident_task"};
+constexpr qint64 recent_completed_days = 7;
+// Completion times are the server's, compared against the local clock
+constexpr qint64 clock_skew_secs = 5 * 60;
+constexpr const char * task_mime_type = "application/x-cutegoogletasks-tasks";
+// Google takes up to 1000 calls per batch; smaller ones report back sooner
+constexpr int move_batch_size = 100;
+// Read-backs before the server's order is accepted as it is: the drop's
+// own and one after a single round of corrections
+constexpr int max_move_rounds = 2;
 
 TreeItem::TreeItem(TreeItem *parentItem): m_parentItem(parentItem)
 {
@@ -63,35 +91,40 @@ TreeItem *TreeItem::parentItem()
     return m_parentItem;
 }
 
-TaskList::TaskList(const QJsonObject &taskListObject, QOAuth2AuthorizationCodeFlow *flow, TreeItem *parent):
-    etag(taskListObject["etag"].toString()),
-    id(taskListObject["id"].toString()),
-    kind(taskListObject["kind"].toString()),
-    selfLink(taskListObject["selfLink"].toString()),
-    title(taskListObject["title"].toString()),
-    updated(taskListObject["updated"].toVariant().toDateTime()),
-    mParent(parent)
+QString TreeItem::key() const
 {
-    auto z = "https://www.googleapis.com/tasks/v1/lists/" + this->id + "/tasks";
-    auto rest2 = flow->get(z);
-    rest2->connect(rest2, &QNetworkReply::finished, [=]() {
-        rest2->deleteLater();
-        if (rest2->error() != QNetworkReply::NoError) {
-            qCritical() << "Google error:" << rest2->errorString() << rest2->error();
-            return;
-        }
+    return {};
+}
 
-        const auto json = rest2->readAll();
+bool TreeItem::updateFrom(const TreeItem &/*other*/)
+{
+    return false;
+}
 
-        const auto document = QJsonDocument::fromJson(json);
-        Q_ASSERT(document.isObject());
-        const auto rootObject = document.object();
-        auto jsons = rootObject.find("items")->toArray();
-        for (auto i: jsons)
-        {
-            appendChild(new Task(i.toObject(), this));
-        }
-    });
+TaskList::TaskList(const QJsonObject &taskListObject, TreeItem *parent):
+    TreeItem(parent),
+    mParent(parent),
+    mCompleted(std::make_unique<CompletedSection>(this))
+{
+    decodeJson(taskListObject, *this, jsonFields());
+}
+
+QUrl TaskList::tasksUrl(const QString &taskListId)
+{
+    QUrl url(api_base_url + QString("/lists/") + taskListId + "/tasks");
+    // Completed tasks are fetched separately, see CompletedSection
+    url.setQuery("maxResults=100&showCompleted=false");
+    return url;
+}
+
+QUrl TaskList::taskUrl(const QString &taskListId, const QString &taskId)
+{
+    return QUrl(api_base_url + QString("/lists/") + taskListId + "/tasks/" + taskId);
+}
+
+QUrl TaskList::moveUrl(const QString &taskListId, const QString &taskId)
+{
+    return QUrl(api_base_url + QString("/lists/") + taskListId + "/tasks/" + taskId + "/move");
 }
 
 void TaskList::appendChild(TreeItem *child)
@@ -101,6 +134,8 @@ void TaskList::appendChild(TreeItem *child)
 
 TreeItem *TaskList::child(int row)
 {
+    if (row == m_childItems.size() && !mEvicted)
+        return mCompleted.get();
     if (row < 0 || row >= m_childItems.size())
             return nullptr;
     return m_childItems.at(row);
@@ -108,7 +143,7 @@ TreeItem *TaskList::child(int row)
 
 int TaskList::childCount() const
 {
-    return m_childItems.count();
+    return m_childItems.count() + (mEvicted ? 0 : 1);
 }
 
 int TaskList::columnCount() const
@@ -118,31 +153,176 @@ int TaskList::columnCount() const
 
 QVariant TaskList::data(int column) const
 {
-    return !column ? title : QVariant{};
+    if (column)
+    {
+        return {};
+    }
+    // Completions count once the section was expanded and loaded them
+    const QLatin1String more(mCompleted->hasMore() ? "+" : "");
+    return QString("%1 (%2 open, %3%4 done)").arg(title).arg(mOpenCount).arg(mCompletedCount).arg(more);
 }
 
-int TaskList::row() const
+TreeItem *TaskList::parentItem()
 {
-    return 0;
+    return mParent;
 }
 
-TreeItem *TaskList::parentItem()
+QString TaskList::getId() const
 {
-    return mParent;
+    return id;
+}
+
+QString TaskList::key() const
+{
+    return id;
+}
+
+int TaskList::openCount() const
+{
+    return mOpenCount;
+}
+
+int TaskList::completedCount() const
+{
+    return mCompletedCount;
+}
+
+QDateTime TaskList::lastActivity() const
+{
+    return mLastActivity;
+}
+
+void TaskList::countTask(const Task &task, int delta)
+{
+    (task.getStatus() == "completed" ? mCompletedCount : mOpenCount) += delta;
+    // Activity only moves forward; removing a task does not make a list older
+    if (delta > 0 && task.getUpdated() > mLastActivity)
+    {
+        mLastActivity = task.getUpdated();
+    }
+}
+
+void TaskList::onTaskToggled(const Task &task)
+{
+    const int delta = task.getStatus() == "completed" ? 1 : -1;
+    mCompletedCount += delta;
+    mOpenCount -= delta;
+    mLastActivity = qMax(mLastActivity, task.getUpdated());
+}
+
+void TaskList::resetOpenCount()
+{
+    mOpenCount = 0;
+}
+
+void TaskList::resetCompletedCount()
+{
+    mCompletedCount = 0;
+}
+
+std::shared_ptr<const TaskListNode> TaskList::node() const
+{
+    if (!mNode)
+    {
+        auto node = std::make_shared<TaskListNode>();
+        node->id = id;
+        node->etag = etag;
+        node->title = title;
+        node->updated = updated;
+        node->openCount = mOpenCount;
+        node->completedCount = mCompletedCount;
+        node->evicted = mEvicted;
+        node->tasks.reserve(m_childItems.size() + mCompleted->m_childItems.size());
+        for (auto i: m_childItems + mCompleted->m_childItems)
+        {
+            node->tasks.append(static_cast<Task*>(i)->node());
+        }
+        mNode = std::move(node);
+    }
+    return mNode;
+}
+
+void TaskList::invalidateNode()
+{
+    mNode.reset();
+}
+
+bool TaskList::updateFrom(const TreeItem &other)
+{
+    const auto & taskList = static_cast<const TaskList&>(other);
+    if (taskList.etag == etag)
+    {
+        return false;
+    }
+    mNode.reset();
+    etag = taskList.etag;
+    kind = taskList.kind;
+    selfLink = taskList.selfLink;
+    title = taskList.title;
+    updated = taskList.updated;
+    return true;
+}
+
+CompletedSection::CompletedSection(TaskList *taskList):
+    TreeItem(taskList)
+{
+
+}
+
+QVariant CompletedSection::data(int column) const
+{
+    if (column)
+    {
+        return {};
+    }
+    // "+" while older pages are still on the server
+    return QString("Completed (%1%2)").arg(m_childItems.size()).arg(mStage == Stage::Done ? "" : "+");
+}
+
+int CompletedSection::row() const
+{
+    return m_parentItem->m_childItems.size();
+}
+
+TaskList *CompletedSection::taskList() const
+{
+    return static_cast<TaskList*>(m_parentItem);
+}
+
+bool CompletedSection::hasMore() const
+{
+    return mStage != Stage::Done;
+}
+
+void CompletedSection::reset()
+{
+    mStage = Stage::Recent;
+    mRecentMin = {};
+    mPageToken.clear();
+    mLoading = false;
+    mWanted = false;
+    mLoad.reset();
 }
 
 Task::Task(const QJsonObject &taskObject, TreeItem *parent):
-    kind(taskObject["kind"].toString()),
-    id(taskObject["id"].toString()),
-    etag(taskObject["etag"].toString()),
-    mTitle(taskObject["title"].toString()),
-    updated(taskObject["updated"].toVariant().toDateTime()),
-    selfLink(taskObject["selfLink"].toString()),
-    position(taskObject["position"].toVariant().toULongLong()),
-    status(taskObject["status"].toString()),
+    TreeItem(parent),
     mParent(parent)
 {
+    decodeJson(taskObject, *this, jsonFields());
+}
+
+TaskList *Task::taskList() const
+{
+    if (auto section = dynamic_cast<CompletedSection*>(mParent))
+    {
+        return section->taskList();
+    }
+    return dynamic_cast<TaskList*>(mParent);
+}
 
+QJsonObject Task::toJson(std::initializer_list<QLatin1String> names) const
+{
+    return encodeJson(*this, jsonFields(), names);
 }
 
 QString Task::getStatus() const
@@ -150,16 +330,243 @@ QString Task::getStatus() const
     return status;
 }
 
+QDateTime Task::getUpdated() const
+{
+    return updated;
+}
+
+QDateTime Task::getDue() const
+{
+    return due;
+}
+
+QDateTime Task::getCompleted() const
+{
+    return completed;
+}
+
+QString Task::getNotes() const
+{
+    return notes;
+}
+
+QString Task::getPosition() const
+{
+    return position;
+}
+
+void Task::moveTo(TaskList *taskList)
+{
+    mParent = taskList;
+    m_parentItem = taskList;
+    invalidateNode();
+}
+
+void Task::moveTo(CompletedSection *section)
+{
+    mParent = section;
+    m_parentItem = section;
+    invalidateNode();
+}
+
+QString Task::key() const
+{
+    return id;
+}
+
+bool Task::setData(const QVariant &value, int role)
+{
+    switch (role)
+    {
+    case Qt::CheckStateRole:
+    {
+        const auto newStatus = value.toBool() ? "completed" : "needsAction";
+        if (status == newStatus)
+        {
+            break;
+        }
+        status = newStatus;
+        updated = QDateTime::currentDateTimeUtc();
+        completed = value.toBool() ? updated : QDateTime{};
+        if (auto list = taskList())
+        {
+            list->onTaskToggled(*this);
+        }
+        break;
+    }
+    case Qt::EditRole:
+    {
+        mTitle = value.toString();
+        break;
+    }
+    default:
+        return false;
+    }
+    invalidateNode();
+    return true;
+}
+
+bool Task::updateFrom(const TreeItem &other)
+{
+    const auto & task = static_cast<const Task&>(other);
+    if (task.etag == etag)
+    {
+        return false;
+    }
+
+    auto list = taskList();
+    if (list)
+    {
+        list->countTask(*this, -1);
+    }
+    kind = task.kind;
+    etag = task.etag;
+    mTitle = task.mTitle;
+    updated = task.updated;
+    selfLink = task.selfLink;
+    position = task.position;
+    status = task.status;
+    due = task.due;
+    completed = task.completed;
+    notes = task.notes;
+    if (list)
+    {
+        list->countTask(*this, 1);
+    }
+    invalidateNode();
+    return true;
+}
+
+std::shared_ptr<const TaskNode> Task::node() const
+{
+    if (!mNode)
+    {
+        mNode = std::make_shared<const TaskNode>(TaskNode{id, etag, mTitle, status, notes, updated, due, completed});
+    }
+    return mNode;
+}
+
+void Task::invalidateNode()
+{
+    mNode.reset();
+    if (auto list = taskList())
+    {
+        list->invalidateNode();
+    }
+}
+
+qint64 Task::footprint() const
+{
+    const auto chars = kind.size() + id.size() + etag.size() + mTitle.size() + status.size() + notes.size();
+    return sizeof(Task) + chars * qint64(sizeof(QChar)) + selfLink.toEncoded().size();
+}
+
+
+static QVector<Task*> tasksFromJson(const QJsonArray & tasks, TaskList * taskList)
+{
+    QVector<Task*> result;
+    result.reserve(tasks.size());
+    for (const auto & i: tasks)
+    {
+        result.append(new Task(i.toObject(), taskList));
+    }
+    return result;
+}
+
+// Marks a longest strictly increasing subsequence of values, in O(n log n)
+static QVector<bool> longestIncreasing(const QVector<int> & values)
+{
+    // tails[k]: index of the smallest value ending an increasing run of length k + 1
+    QVector<int> tails;
+    QVector<int> previous(values.size(), -1);
+    for (int i = 0; i < values.size(); ++i)
+    {
+        const auto it = std::lower_bound(tails.begin(), tails.end(), values[i], [&values](int tail, int value) {
+            return values[tail] < value;
+        });
+        if (it != tails.begin())
+        {
+            previous[i] = *std::prev(it);
+        }
+        if (it == tails.end())
+        {
+            tails.append(i);
+        }
+        else
+        {
+            *it = i;
+        }
+    }
+
+    QVector<bool> result(values.size(), false);
+    for (int i = tails.isEmpty() ? -1 : tails.last(); i >= 0; i = previous[i])
+    {
+        result[i] = true;
+    }
+    return result;
+}
+
+// State of one download that spans several pages
+// Batch request line of one move; the task goes after previous, or first
+static QByteArray moveCall(const QString & taskListId, const QString & taskId,
+                           const QString & previous, const QString & destination)
+{
+    auto url = TaskList::moveUrl(taskListId, taskId);
+    QUrlQuery query;
+    if (!previous.isEmpty())
+    {
+        query.addQueryItem("previous", previous);
+    }
+    if (destination != taskListId)
+    {
+        query.addQueryItem("destinationTasklist", destination);
+    }
+    url.setQuery(query);
+    return "POST " + url.toEncoded(QUrl::RemoveScheme | QUrl::RemoveAuthority) + " HTTP/1.1";
+}
+
+// Server copy of the lists touched by moves, read back after the moves
+struct TreeModel::MoveCheck
+{
+    QHash<QString, QVector<QByteArray>> items;
+    QHash<QString, QByteArray> etags;
+    int pending = 0;
+    bool failed = false;
+};
+
+struct TreeModel::TaskLoad
+{
+    // Whatever a cancelled or failed load had parsed
+    ~TaskLoad()
+    {
+        qDeleteAll(tasks);
+    }
+
+    TaskList * taskList = nullptr;
+    QByteArray etag;
+    QVector<Task*> tasks;
+    std::unique_ptr<TaskCache::Writer> cache;
+};
 
 TreeModel::TreeModel(const QJsonArray &data, std::shared_ptr<QOAuth2AuthorizationCodeFlow> flow, QObject *parent)
     : QAbstractItemModel(parent)
+    , mFlow(flow)
+    , mMemoryBudget(default_memory_budget)
 {
+    static int models = 0;
+    mMetricsId = QByteArray::number(models++);
+
     rootItem = new TreeItem();
-    setupModelData(data, flow.get(), rootItem);
+    setupModelData(data, rootItem);
+    schedulePublish();
 }
 
 TreeModel::~TreeModel()
 {
+    for (auto kind: node_kinds)
+    {
+        Metrics::instance().removeGauge(metric_model_nodes, Metrics::labels({{"model", mMetricsId}, {"kind", kind}}));
+    }
     delete rootItem;
 }
 
@@ -181,7 +588,7 @@ QVariant TreeModel::data(const QModelIndex &index, int role) const
     case Qt::SizeHintRole:
     {
         QSize size{};
-        size.setHeight(dynamic_cast<Task*>(reinterpret_cast<TreeItem*>(index.internalPointer())) ? 25 : 50);
+        size.setHeight(dynamic_cast<TaskList*>(reinterpret_cast<TreeItem*>(index.internalPointer())) ? 50 : 25);
         return size;
     }
     case Qt::CheckStateRole:
@@ -199,6 +606,29 @@ QVariant TreeModel::data(const QModelIndex &index, int role) const
     {
         return QBrush{QColor{Qt::black}};
     }
+    case Qt::ToolTipRole:
+    {
+        if (auto x = dynamic_cast<TaskList*>(reinterpret_cast<TreeItem*>(index.internalPointer())); x != nullptr)
+        {
+            return QString("Last activity: %1").arg(QLocale().toString(x->lastActivity().toLocalTime(), QLocale::ShortFormat));
+        }
+        return {};
+    }
+    case OpenCountRole:
+    case CompletedCountRole:
+    case LastActivityRole:
+    {
+        auto x = dynamic_cast<TaskList*>(reinterpret_cast<TreeItem*>(index.internalPointer()));
+        if (!x)
+        {
+            return {};
+        }
+        if (role == OpenCountRole)
+            return x->openCount();
+        if (role == CompletedCountRole)
+            return x->completedCount();
+        return x->lastActivity();
+    }
     case Qt::DecorationRole:
     {
         if (dynamic_cast<TaskList*>(reinterpret_cast<TreeItem*>(index.internalPointer())) != nullptr)
@@ -217,7 +647,49 @@ QVariant TreeModel::data(const QModelIndex &index, int role) const
 
 bool TreeModel::setData(const QModelIndex &index, const QVariant &value, int role)
 {
-    return index.isValid() && reinterpret_cast<TreeItem*>(index.internalPointer())->setData(value, role);
+    if (!index.isValid() || !reinterpret_cast<TreeItem*>(index.internalPointer())->setData(value, role))
+    {
+        return false;
+    }
+    emit dataChanged(index, index, {role});
+    schedulePublish();
+    auto task = dynamic_cast<Task*>(reinterpret_cast<TreeItem*>(index.internalPointer()));
+    if (auto taskList = task ? task->taskList() : nullptr)
+    {
+        mIndex.update(*task, taskList->getId());
+        emit taskIndexChanged();
+        if (task->parentItem() == taskList->mCompleted.get())
+        {
+            storeCompleted(taskList);
+        }
+        else
+        {
+            storeTasks(taskList);
+        }
+        if (role == Qt::CheckStateRole)
+        {
+            aggregatesChanged(taskList);
+            patchTask(*task, taskList->getId(), {QLatin1String("status"), QLatin1String("completed")});
+        }
+        else
+        {
+            patchTask(*task, taskList->getId(), {QLatin1String("title")});
+        }
+    }
+    return true;
+}
+
+void TreeModel::sort(int column, Qt::SortOrder order)
+{
+    Q_UNUSED(column)
+    mSortOrder = order;
+    mSorted = true;
+    resort();
+}
+
+void TreeModel::setSortRole(int role)
+{
+    mSortRole = role;
 }
 
 Qt::ItemFlags TreeModel::flags(const QModelIndex &index) const
@@ -225,9 +697,19 @@ Qt::ItemFlags TreeModel::flags(const QModelIndex &index) const
     if (!index.isValid())
         return Qt::NoItemFlags;
     auto flags = QAbstractItemModel::flags(index);
-    if (dynamic_cast<Task*>(reinterpret_cast<TreeItem*>(index.internalPointer())))
+    auto item = reinterpret_cast<TreeItem*>(index.internalPointer());
+    if (dynamic_cast<Task*>(item))
     {
         flags |= (Qt::ItemIsUserCheckable | Qt::ItemIsEditable);
+        // Completed tasks keep the order the server gives them
+        if (dynamic_cast<TaskList*>(item->parentItem()))
+        {
+            flags |= Qt::ItemIsDragEnabled;
+        }
+    }
+    else if (dynamic_cast<TaskList*>(item))
+    {
+        flags |= Qt::ItemIsDropEnabled;
     }
 
     return flags;
@@ -288,10 +770,1345 @@ int TreeModel::rowCount(const QModelIndex &parent) const
     return parentItem->childCount();
 }
 
-void TreeModel::setupModelData(const QJsonArray &lines, QOAuth2AuthorizationCodeFlow * flow, TreeItem *parent)
+TaskList *TreeModel::findTaskList(const QString &taskListId) const
 {
-    for (const auto & i: lines)
+    for (auto i: rootItem->m_childItems)
+    {
+        if (auto taskList = static_cast<TaskList*>(i); taskList->getId() == taskListId)
+        {
+            return taskList;
+        }
+    }
+    return nullptr;
+}
+
+void TreeModel::setTaskLists(const QJsonArray &taskLists)
+{
+    QVector<TreeItem*> fresh;
+    fresh.reserve(taskLists.size());
+    for (const auto & i: taskLists)
     {
-        parent->appendChild(new TaskList(i.toObject(), flow, parent));
+        fresh.append(new TaskList(i.toObject(), rootItem));
+    }
+
+    QVector<TreeItem*> adopted, updated, removed;
+    reconcileChildren(rootItem, fresh, adopted, updated, removed);
+
+    for (auto i: removed)
+    {
+        auto taskList = static_cast<TaskList*>(i);
+        mMemoryUsage -= taskList->mFootprint;
+        mCache.remove(taskList->getId());
+        mCompletedCache.remove(taskList->getId());
+        mIndex.removeTaskList(taskList->getId());
+        delete taskList;
+    }
+    if (!removed.isEmpty())
+    {
+        emit taskIndexChanged();
+    }
+    for (auto i: adopted)
+    {
+        fetchTasks(static_cast<TaskList*>(i));
+    }
+    // Reconciliation restores server order
+    if (mSorted)
+    {
+        resort();
+    }
+    schedulePublish();
+}
+
+void TreeModel::setTasks(const QString &taskListId, const QJsonArray &tasks)
+{
+    auto taskList = findTaskList(taskListId);
+    if (!taskList)
+    {
+        return;
+    }
+
+    mCache.store(taskListId, taskList->title, tasks);
+    adoptTasks(taskList, tasksFromJson(tasks, taskList));
+}
+
+void TreeModel::setTasks(const QString &taskListId, const QVector<QByteArray> &items)
+{
+    auto taskList = findTaskList(taskListId);
+    if (!taskList)
+    {
+        return;
+    }
+
+    auto cache = mCache.writer(taskListId, taskList->title);
+    QVector<Task*> tasks;
+    tasks.reserve(items.size());
+    for (const auto & i: items)
+    {
+        cache->append(i);
+        tasks.append(new Task(QJsonDocument::fromJson(i).object(), taskList));
+    }
+    cache->commit();
+    adoptTasks(taskList, tasks);
+}
+
+void TreeModel::reloadTasks(const QString &taskListId)
+{
+    if (auto taskList = findTaskList(taskListId))
+    {
+        fetchTasks(taskList);
+    }
+}
+
+bool TreeModel::hasChildren(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+    {
+        auto item = static_cast<TreeItem*>(parent.internalPointer());
+        if (auto taskList = dynamic_cast<TaskList*>(item); taskList && taskList->mEvicted)
+        {
+            // Its completed section at least
+            return true;
+        }
+        if (auto section = dynamic_cast<CompletedSection*>(item))
+        {
+            return section->childCount() || section->mStage != CompletedSection::Stage::Done;
+        }
+    }
+    return QAbstractItemModel::hasChildren(parent);
+}
+
+bool TreeModel::canFetchMore(const QModelIndex &parent) const
+{
+    if (!parent.isValid())
+    {
+        return false;
+    }
+    auto item = static_cast<TreeItem*>(parent.internalPointer());
+    if (auto section = dynamic_cast<CompletedSection*>(item))
+    {
+        return section->mStage != CompletedSection::Stage::Done && !section->mLoading;
+    }
+    // A running download rehydrates the list once it lands, provided the
+    // view expanded it meanwhile
+    auto taskList = dynamic_cast<TaskList*>(item);
+    return taskList && taskList->mEvicted && !taskList->mLoading;
+}
+
+void TreeModel::fetchMore(const QModelIndex &parent)
+{
+    if (!canFetchMore(parent))
+    {
+        return;
+    }
+    if (auto section = dynamic_cast<CompletedSection*>(static_cast<TreeItem*>(parent.internalPointer())))
+    {
+        section->taskList()->mLastUsed = ++mUseClock;
+        section->mWanted = true;
+        fetchCompleted(section);
+        return;
+    }
+    auto taskList = static_cast<TaskList*>(parent.internalPointer());
+    // The view only fetches a list it is about to expand
+    taskList->mExpanded = true;
+    taskList->mLastUsed = ++mUseClock;
+
+    if (QJsonArray tasks; mCache.load(taskList->getId(), tasks))
+    {
+        adoptTasks(taskList, tasksFromJson(tasks, taskList));
+    }
+    else
+    {
+        fetchTasks(taskList);
+    }
+}
+
+Qt::DropActions TreeModel::supportedDropActions() const
+{
+    return Qt::MoveAction;
+}
+
+QStringList TreeModel::mimeTypes() const
+{
+    return {task_mime_type};
+}
+
+QMimeData *TreeModel::mimeData(const QModelIndexList &indexes) const
+{
+    // (list row, task row), so the tasks land in the order they were shown
+    QVector<QPair<QPair<int, int>, Task*>> dragged;
+    for (const auto & i: indexes)
+    {
+        auto task = dynamic_cast<Task*>(static_cast<TreeItem*>(i.internalPointer()));
+        if (i.column() == 0 && task && dynamic_cast<TaskList*>(task->parentItem()))
+        {
+            dragged.append({{i.parent().row(), i.row()}, task});
+        }
+    }
+    if (dragged.isEmpty())
+    {
+        return nullptr;
+    }
+    std::sort(dragged.begin(), dragged.end(), [](const auto & a, const auto & b) { return a.first < b.first; });
+
+    QVector<QPair<QString, QString>> ids;
+    ids.reserve(dragged.size());
+    for (const auto & i: dragged)
+    {
+        ids.append({i.second->taskList()->getId(), i.second->key()});
+    }
+    QByteArray encoded;
+    QDataStream stream(&encoded, QIODevice::WriteOnly);
+    stream << ids;
+
+    auto data = new QMimeData;
+    data->setData(task_mime_type, encoded);
+    return data;
+}
+
+bool TreeModel::canDropMimeData(const QMimeData *data, Qt::DropAction action, int row, int column,
+                                const QModelIndex &parent) const
+{
+    Q_UNUSED(row)
+    Q_UNUSED(column)
+    if (action != Qt::MoveAction || !data->hasFormat(task_mime_type) || !parent.isValid())
+    {
+        return false;
+    }
+    // Between the open tasks of a list whose payload is in memory
+    auto taskList = dynamic_cast<TaskList*>(static_cast<TreeItem*>(parent.internalPointer()));
+    return taskList && !taskList->mEvicted;
+}
+
+bool TreeModel::dropMimeData(const QMimeData *data, Qt::DropAction action, int row, int column,
+                             const QModelIndex &parent)
+{
+    if (!canDropMimeData(data, action, row, column, parent))
+    {
+        return false;
+    }
+
+    QVector<QPair<QString, QString>> ids;
+    QDataStream stream(data->data(task_mime_type));
+    stream >> ids;
+
+    QHash<QString, Task*> openTasks;
+    QSet<QString> taskListIds;
+    for (const auto & i: qAsConst(ids))
+    {
+        if (auto taskList = findTaskList(i.first); taskList && !taskListIds.contains(i.first))
+        {
+            taskListIds.insert(i.first);
+            for (auto task: taskList->m_childItems)
+            {
+                openTasks.insert(task->key(), static_cast<Task*>(task));
+            }
+        }
+    }
+    // Tasks gone or completed since the drag started are left out
+    QVector<Task*> tasks;
+    for (const auto & i: qAsConst(ids))
+    {
+        if (auto task = openTasks.value(i.second))
+        {
+            tasks.append(task);
+        }
+    }
+    if (tasks.isEmpty())
+    {
+        return false;
+    }
+
+    auto destination = static_cast<TaskList*>(parent.internalPointer());
+    // Dropped on the list itself or onto its completed section: after the open tasks
+    const int last = destination->m_childItems.size();
+    moveTasks(tasks, destination, row < 0 || row > last ? last : row);
+    return true;
+}
+
+void TreeModel::moveTasks(const QVector<Task*> &tasks, TaskList *destination, int row)
+{
+    auto & children = destination->m_childItems;
+    const QSet<TreeItem*> moving(tasks.cbegin(), tasks.cend());
+
+    // The children vector is the order structure: a dropped block is spliced
+    // in with one block move per source run, siblings are never renumbered.
+    // No local sort key is made up; Google positions need not leave room
+    // between neighbours (subtasks, runs of zeros), so keys could tie.
+    int before = row - 1;
+    while (before >= 0 && moving.contains(children[before]))
+    {
+        --before;
+    }
+    const auto previous = before >= 0 ? static_cast<Task*>(children[before]) : nullptr;
+
+    QVector<QString> sourceIds;
+    sourceIds.reserve(tasks.size());
+    for (auto task: tasks)
+    {
+        sourceIds.append(task->taskList()->getId());
+    }
+
+    // One row move per run of tasks that are adjacent at their source, so a
+    // dragged block is a single beginMoveRows()
+    const auto destinationIndex = createIndex(destination->row(), 0, destination);
+    QSet<TaskList*> touched{destination};
+    bool moved = false;
+    int target = row;
+    for (int i = 0; i < tasks.size();)
+    {
+        auto source = tasks[i]->taskList();
+        auto & sourceChildren = source->m_childItems;
+        const int first = sourceChildren.indexOf(tasks[i]);
+        int count = 1;
+        while (i + count < tasks.size() && first + count < sourceChildren.size()
+               && sourceChildren[first + count] == tasks[i + count])
+        {
+            ++count;
+        }
+
+        if (source == destination && target >= first && target <= first + count)
+        {
+            // Already where it was dropped
+            target = first + count;
+        }
+        else
+        {
+            beginMoveRows(createIndex(source->row(), 0, source), first, first + count - 1, destinationIndex, target);
+            const auto run = sourceChildren.mid(first, count);
+            sourceChildren.remove(first, count);
+            if (source == destination && first < target)
+            {
+                target -= count;
+            }
+            children.insert(target, count, nullptr);
+            std::copy(run.cbegin(), run.cend(), children.begin() + target);
+            endMoveRows();
+            target += count;
+            moved = true;
+        }
+
+        for (int j = i; j < i + count; ++j)
+        {
+            auto task = tasks[j];
+            if (source != destination)
+            {
+                source->countTask(*task, -1);
+                destination->countTask(*task, 1);
+                source->mFootprint -= task->footprint();
+                destination->mFootprint += task->footprint();
+                mIndex.update(*task, destination->getId());
+            }
+            task->moveTo(destination);
+        }
+        touched.insert(source);
+        i += count;
+    }
+    if (!moved)
+    {
+        return;
+    }
+
+    for (auto i: touched)
+    {
+        aggregatesChanged(i);
+        storeTasks(i);
+    }
+    if (touched.size() > 1)
+    {
+        emit taskIndexChanged();
+    }
+
+    if (!mFlow)
+    {
+        return;
+    }
+    // Each task goes after the one before it, the first after the task it was
+    // dropped below. One wave per drop: a batch usually runs in order, and
+    // verifyMoves() repairs whatever it scrambled.
+    QVector<QByteArray> wave;
+    wave.reserve(tasks.size());
+    for (int i = 0; i < tasks.size(); ++i)
+    {
+        const auto previousTask = i ? tasks[i - 1] : previous;
+        wave.append(moveCall(sourceIds[i], tasks[i]->key(), previousTask ? previousTask->key() : QString(),
+                             destination->getId()));
+        mMoveLists.insert(sourceIds[i]);
+    }
+    mMoveQueue.append(wave);
+    mMoveLists.insert(destination->getId());
+    // New intent, so the read-back starts over
+    mMoveRound = 0;
+    if (!mMoveInFlight)
+    {
+        sendMoves();
+    }
+}
+
+void TreeModel::sendMoves()
+{
+    auto & wave = mMoveQueue.first();
+    const int count = qMin(wave.size(), move_batch_size);
+    auto body = batchBody(wave.mid(0, count));
+    wave.remove(0, count);
+    if (wave.isEmpty())
+    {
+        mMoveQueue.removeFirst();
+    }
+    mMoveInFlight = true;
+
+    const auto send = [body](QNetworkAccessManager & manager, const QNetworkRequest & request) {
+        auto reply = manager.post(request, body);
+        body->setParent(reply);
+        return reply;
+    };
+    ApiCall::send(*mFlow, QNetworkRequest(QUrl(api_batch_url)), mCancellation.token(), send)
+            .then([this, count](const ApiResponse & response) {
+        const auto statuses = batchStatuses(response.reply);
+        const auto failed = count - std::count_if(statuses.cbegin(), statuses.cend(), [](int status) {
+            return status >= 200 && status < 300;
+        });
+        if (failed)
+        {
+            // A move naming a task the server has not placed yet fails; the
+            // read-back sends it again
+            qWarning() << "Failed to move" << failed << "of" << count << "tasks:" << response.reply->errorString();
+        }
+        if (!mMoveQueue.isEmpty())
+        {
+            sendMoves();
+            return;
+        }
+        verifyMoves();
+    });
+}
+
+void TreeModel::verifyMoves()
+{
+    ++mMoveRound;
+    auto check = std::make_shared<MoveCheck>();
+    check->pending = mMoveLists.size();
+    for (const auto & i: qAsConst(mMoveLists))
+    {
+        fetchMoveCheck(check, i, {});
+    }
+}
+
+void TreeModel::fetchMoveCheck(std::shared_ptr<MoveCheck> check, const QString &taskListId, const QString &pageToken)
+{
+    auto url = TaskList::tasksUrl(taskListId);
+    if (!pageToken.isEmpty())
+    {
+        QUrlQuery query(url);
+        query.addQueryItem("pageToken", pageToken);
+        url.setQuery(query);
+    }
+
+    ApiCall::get(*mFlow, url, mCancellation.token())
+            .onItem([check, taskListId](const QByteArray & item) {
+        check->items[taskListId].append(item);
+    }).then([this, check, taskListId](const ApiResponse & response) {
+        if (!check->etags.contains(taskListId))
+        {
+            check->etags.insert(taskListId, response.reply->rawHeader("ETag"));
+        }
+        if (!response.ok)
+        {
+            qCritical() << "Google error:" << response.reply->errorString() << response.reply->error();
+            check->failed = true;
+        }
+        else if (const auto next = response.field("nextPageToken"); !next.isEmpty())
+        {
+            fetchMoveCheck(check, taskListId, next);
+            return;
+        }
+        if (--check->pending == 0)
+        {
+            checkMoves(*check);
+        }
+    });
+}
+
+void TreeModel::checkMoves(const MoveCheck &check)
+{
+    if (!mMoveQueue.isEmpty())
+    {
+        // Dropped again meanwhile; those moves go first and are read back after
+        sendMoves();
+        return;
+    }
+
+    // Where the server keeps each task, in the order it lists them
+    QHash<QString, QString> serverList;
+    QHash<QString, int> serverRow;
+    for (auto it = check.items.cbegin(); it != check.items.cend(); ++it)
+    {
+        for (int i = 0; i < it->size(); ++i)
+        {
+            const auto id = QJsonDocument::fromJson(it->at(i)).object()["id"].toString();
+            serverList.insert(id, it.key());
+            serverRow.insert(id, i);
+        }
+    }
+
+    // The local order is the intended one. Per list, the longest run the
+    // server already has in that order stays. Every other task goes after the
+    // last task before it that stays, which no call of the batch moves, so no
+    // call waits on another. A misplaced run is sent last task first: in the
+    // order the batch usually runs, each lands between the anchor and the
+    // ones sent before it.
+    QVector<QByteArray> corrections;
+    for (const auto & taskListId: qAsConst(mMoveLists))
+    {
+        auto taskList = findTaskList(taskListId);
+        if (check.failed || !taskList || taskList->mEvicted)
+        {
+            continue;
+        }
+        const auto & children = taskList->m_childItems;
+        QVector<int> rows;
+        QVector<TreeItem*> placed;
+        for (auto i: children)
+        {
+            if (serverList.value(i->key()) == taskListId)
+            {
+                rows.append(serverRow.value(i->key()));
+                placed.append(i);
+            }
+        }
+        const auto increasing = longestIncreasing(rows);
+        QSet<TreeItem*> stays;
+        for (int i = 0; i < placed.size(); ++i)
+        {
+            if (increasing[i])
+            {
+                stays.insert(placed[i]);
+            }
+        }
+
+        QString anchor;
+        QVector<QByteArray> run;
+        for (auto i: children)
+        {
+            const auto id = i->key();
+            if (!serverList.contains(id))
+            {
+                // Deleted elsewhere; the next refresh drops it
+                continue;
+            }
+            if (stays.contains(i))
+            {
+                std::copy(run.crbegin(), run.crend(), std::back_inserter(corrections));
+                run.clear();
+                anchor = id;
+            }
+            else
+            {
+                run.append(moveCall(serverList.value(id), id, anchor, taskListId));
+            }
+        }
+        std::copy(run.crbegin(), run.crend(), std::back_inserter(corrections));
+    }
+
+    if (!corrections.isEmpty() && mMoveRound < max_move_rounds)
+    {
+        mMoveQueue = {corrections};
+        sendMoves();
+        return;
+    }
+    if (!corrections.isEmpty())
+    {
+        qWarning() << "Task order still differs from the server after" << mMoveRound << "rounds; keeping the server's";
+    }
+
+    mMoveInFlight = false;
+    mMoveRound = 0;
+    for (const auto & i: std::exchange(mMoveLists, {}))
+    {
+        if (check.failed)
+        {
+            reloadTasks(i);
+            continue;
+        }
+        setTasks(i, check.items.value(i));
+        emit tasksLoaded(i, check.etags.value(i));
+    }
+}
+
+void TreeModel::setMemoryBudget(qint64 bytes)
+{
+    mMemoryBudget = bytes;
+    enforceMemoryBudget();
+}
+
+qint64 TreeModel::memoryUsage() const
+{
+    return mMemoryUsage;
+}
+
+const TaskIndex &TreeModel::taskIndex() const
+{
+    return mIndex;
+}
+
+TaskTreeSnapshotPtr TreeModel::snapshot() const
+{
+    return std::atomic_load(&mSnapshot);
+}
+
+void TreeModel::onExpanded(const QModelIndex &index)
+{
+    if (auto taskList = dynamic_cast<TaskList*>(static_cast<TreeItem*>(index.internalPointer())))
+    {
+        taskList->mExpanded = true;
+        taskList->mLastUsed = ++mUseClock;
+    }
+}
+
+void TreeModel::onCollapsed(const QModelIndex &index)
+{
+    if (auto taskList = dynamic_cast<TaskList*>(static_cast<TreeItem*>(index.internalPointer())))
+    {
+        taskList->mExpanded = false;
+        taskList->mLastUsed = ++mUseClock;
+        enforceMemoryBudget();
+    }
+}
+
+void TreeModel::adoptTasks(TaskList *taskList, const QVector<Task*> &tasks)
+{
+    if (mMoveLists.contains(taskList->getId()))
+    {
+        // Could predate moves the server has not applied yet; the list is
+        // read back once they are
+        qDeleteAll(tasks);
+        return;
+    }
+    if (taskList->mEvicted && !taskList->mExpanded)
+    {
+        // Stays evicted, the fresh payload is read back from the cache on
+        // expand. Completed tasks are not part of it and keep their counts.
+        taskList->resetOpenCount();
+        mIndex.removeTasks(taskList->getId(), false);
+        for (auto task: tasks)
+        {
+            taskList->countTask(*task, 1);
+            mIndex.update(*task, taskList->getId());
+        }
+        qDeleteAll(tasks);
+        aggregatesChanged(taskList);
+        emit taskIndexChanged();
+        return;
+    }
+    reconcileTasks(taskList, tasks);
+    enforceMemoryBudget();
+}
+
+void TreeModel::reconcileTasks(TaskList *taskList, const QVector<Task*> &tasks)
+{
+    const auto listIndex = createIndex(taskList->row(), 0, taskList);
+    const bool rehydrated = taskList->mEvicted;
+    const auto syncedAt = std::exchange(taskList->mSyncedAt, QDateTime::currentDateTimeUtc());
+    if (rehydrated)
+    {
+        // The open count still describes the evicted payload, which comes
+        // back as new rows. The section is read back before it reappears.
+        taskList->resetOpenCount();
+        mIndex.removeTasks(taskList->getId(), false);
+        restoreCompleted(taskList);
+        beginInsertRows(listIndex, 0, 0);
+        taskList->mEvicted = false;
+        endInsertRows();
+    }
+
+    QVector<TreeItem*> adopted, updated, removed;
+    reconcileChildren(taskList, QVector<TreeItem*>(tasks.cbegin(), tasks.cend()), adopted, updated, removed);
+
+    // A task reopened elsewhere is back among the open ones; drop its completed copy
+    auto section = taskList->mCompleted.get();
+    QSet<QString> openIds;
+    for (auto i: taskList->m_childItems)
+    {
+        openIds.insert(i->key());
+    }
+    const auto sectionIndex = createIndex(section->row(), 0, section);
+    bool sectionChanged = false;
+    for (int i = section->m_childItems.size() - 1; i >= 0; --i)
+    {
+        if (openIds.contains(section->m_childItems[i]->key()))
+        {
+            beginRemoveRows(sectionIndex, i, i);
+            auto reopened = static_cast<Task*>(section->m_childItems.takeAt(i));
+            endRemoveRows();
+            // Its index entry now belongs to the open copy
+            taskList->countTask(*reopened, -1);
+            delete reopened;
+            sectionChanged = true;
+        }
+    }
+
+    // The server lists open tasks only, so a task checked here drops out of
+    // the payload; it belongs to the completed section from now on
+    QVector<Task*> completed;
+    for (auto it = removed.begin(); it != removed.end();)
+    {
+        auto task = static_cast<Task*>(*it);
+        if (task->getStatus() == "completed")
+        {
+            completed.append(task);
+            it = removed.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+    if (!completed.isEmpty())
+    {
+        QSet<QString> known;
+        for (auto i: section->m_childItems)
+        {
+            known.insert(i->key());
+        }
+        const int first = section->m_childItems.size();
+        int count = 0;
+        for (auto task: completed)
+        {
+            count += !known.contains(task->key());
+        }
+        if (count)
+        {
+            beginInsertRows(sectionIndex, first, first + count - 1);
+        }
+        for (auto task: completed)
+        {
+            if (known.contains(task->key()))
+            {
+                // Already loaded into the section, which owns the index entry
+                taskList->countTask(*task, -1);
+                delete task;
+                continue;
+            }
+            // Counted and indexed as completed since it was checked
+            task->moveTo(section);
+            section->m_childItems.append(task);
+        }
+        if (count)
+        {
+            endInsertRows();
+            sectionChanged = true;
+        }
+    }
+    if (sectionChanged)
+    {
+        storeCompleted(taskList);
+    }
+
+    for (auto i: removed)
+    {
+        taskList->countTask(*static_cast<Task*>(i), -1);
+        mIndex.remove(i->key(), taskList->getId());
+    }
+    for (auto i: adopted)
+    {
+        taskList->countTask(*static_cast<Task*>(i), 1);
+    }
+    for (auto i: adopted + updated)
+    {
+        mIndex.update(*static_cast<Task*>(i), taskList->getId());
+    }
+    // A task completed on another device leaves the payload just like a
+    // deleted one, and so may have while the list was evicted. Whatever was
+    // completed since the last payload comes into the section.
+    if ((rehydrated || !removed.isEmpty()) && syncedAt.isValid())
+    {
+        fetchCompletedSince(section, syncedAt.addSecs(-clock_skew_secs), {});
+    }
+    qDeleteAll(removed);
+    aggregatesChanged(taskList);
+    if (rehydrated || !adopted.isEmpty() || !updated.isEmpty() || !removed.isEmpty())
+    {
+        emit taskIndexChanged();
+    }
+
+    mMemoryUsage -= taskList->mFootprint;
+    taskList->mFootprint = 0;
+    for (auto i: taskList->m_childItems + section->m_childItems)
+    {
+        taskList->mFootprint += static_cast<Task*>(i)->footprint();
+    }
+    mMemoryUsage += taskList->mFootprint;
+}
+
+void TreeModel::reconcileChildren(TreeItem *parentItem, const QVector<TreeItem*> &fresh,
+                                  QVector<TreeItem*> &adopted, QVector<TreeItem*> &updated,
+                                  QVector<TreeItem*> &removed)
+{
+    const auto parentIndex = parentItem == rootItem ? QModelIndex() : createIndex(parentItem->row(), 0, parentItem);
+    auto & children = parentItem->m_childItems;
+
+    QHash<QString, int> freshRows;
+    for (int i = 0; i < fresh.size(); ++i)
+    {
+        freshRows.insert(fresh[i]->key(), i);
+    }
+
+    // Removals back to front so pending row numbers stay valid, one signal per run
+    for (int last = children.size() - 1; last >= 0;)
+    {
+        if (freshRows.contains(children[last]->key()))
+        {
+            --last;
+            continue;
+        }
+        int first = last;
+        while (first > 0 && !freshRows.contains(children[first - 1]->key()))
+        {
+            --first;
+        }
+        beginRemoveRows(parentIndex, first, last);
+        removed += children.mid(first, last - first + 1);
+        children.remove(first, last - first + 1);
+        endRemoveRows();
+        last = first - 1;
+    }
+
+    QHash<QString, TreeItem*> current;
+    QHash<TreeItem*, int> rows;
+    QVector<int> ranks;
+    ranks.reserve(children.size());
+    for (int i = 0; i < children.size(); ++i)
+    {
+        current.insert(children[i]->key(), children[i]);
+        rows.insert(children[i], i);
+        ranks.append(freshRows.value(children[i]->key()));
+    }
+
+    // The longest run of survivors already in fresh order stays put; every
+    // other survivor is moved once, right behind its fresh predecessor
+    const auto increasing = longestIncreasing(ranks);
+    QSet<TreeItem*> stays;
+    for (int i = 0; i < children.size(); ++i)
+    {
+        if (increasing[i])
+        {
+            stays.insert(children[i]);
+        }
+    }
+    QVector<TreeItem*> order;
+    order.reserve(children.size());
+    for (auto i: fresh)
+    {
+        if (auto existing = current.value(i->key()))
+        {
+            order.append(existing);
+        }
+    }
+    TreeItem * placed = nullptr;
+    for (int t = 0; t < order.size();)
+    {
+        const int from = rows.value(order[t]);
+        if (stays.contains(order[t]))
+        {
+            placed = order[t++];
+            continue;
+        }
+        // Neighbours in both orders travel in one signal
+        int count = 1;
+        while (t + count < order.size() && !stays.contains(order[t + count])
+               && rows.value(order[t + count]) == from + count)
+        {
+            ++count;
+        }
+        const int to = placed ? rows.value(placed) + 1 : 0;
+        if (to != from && to != from + count)
+        {
+            beginMoveRows(parentIndex, from, from + count - 1, parentIndex, to);
+            const auto first = children.begin();
+            if (to < from)
+            {
+                std::rotate(first + to, first + from, first + from + count);
+            }
+            else
+            {
+                std::rotate(first + from, first + from + count, first + to);
+            }
+            endMoveRows();
+            for (int j = qMin(from, to), end = qMax(from + count, to); j < end; ++j)
+            {
+                rows[children[j]] = j;
+            }
+        }
+        placed = order[t + count - 1];
+        t += count;
+    }
+
+    // Survivors are in fresh order now; new rows go in between, front to back
+    for (int i = 0; i < fresh.size(); ++i)
+    {
+        auto existing = current.value(fresh[i]->key());
+        if (!existing)
+        {
+            int last = i;
+            while (last + 1 < fresh.size() && !current.contains(fresh[last + 1]->key()))
+            {
+                ++last;
+            }
+            beginInsertRows(parentIndex, i, last);
+            for (int j = i; j <= last; ++j)
+            {
+                children.insert(j, fresh[j]);
+                adopted.append(fresh[j]);
+            }
+            endInsertRows();
+            i = last;
+            continue;
+        }
+
+        Q_ASSERT(children[i] == existing);
+        if (existing->updateFrom(*fresh[i]))
+        {
+            const auto index = createIndex(i, 0, existing);
+            emit dataChanged(index, index);
+            updated.append(existing);
+        }
+        delete fresh[i];
+    }
+}
+
+void TreeModel::evict(TaskList *taskList)
+{
+    // The completed section goes with the open tasks. Both are cached, so
+    // counts and index entries stay; the section keeps how far it had
+    // loaded, only the page in flight is dropped.
+    auto section = taskList->mCompleted.get();
+    beginRemoveRows(createIndex(taskList->row(), 0, taskList), 0, taskList->childCount() - 1);
+    qDeleteAll(taskList->m_childItems);
+    taskList->m_childItems.clear();
+    qDeleteAll(section->m_childItems);
+    section->m_childItems.clear();
+    section->mLoad.reset();
+    section->mLoading = false;
+    taskList->mEvicted = true;
+    endRemoveRows();
+
+    mMemoryUsage -= taskList->mFootprint;
+    taskList->mFootprint = 0;
+    aggregatesChanged(taskList);
+}
+
+void TreeModel::restoreCompleted(TaskList *taskList)
+{
+    // The cache may hold more or less than was counted, a previous run's
+    // tasks or none at all, so its contents are counted from scratch
+    auto section = taskList->mCompleted.get();
+    taskList->resetCompletedCount();
+    mIndex.removeTasks(taskList->getId(), true);
+    QJsonArray tasks;
+    if (!mCompletedCache.load(taskList->getId(), tasks))
+    {
+        // What the section had loaded is gone; it starts over when expanded
+        section->reset();
+        return;
+    }
+    for (const auto & i: tasks)
+    {
+        auto task = new Task(i.toObject(), section);
+        section->m_childItems.append(task);
+        taskList->countTask(*task, 1);
+        mIndex.update(*task, taskList->getId());
+    }
+}
+
+void TreeModel::aggregatesChanged(TaskList *taskList)
+{
+    taskList->invalidateNode();
+    schedulePublish();
+    const auto index = createIndex(taskList->row(), 0, taskList);
+    emit dataChanged(index, index, {Qt::DisplayRole, Qt::ToolTipRole, OpenCountRole, CompletedCountRole, LastActivityRole});
+    // Sorted by an aggregate, the list may have to move
+    if (mSorted && (mSortRole == OpenCountRole || mSortRole == CompletedCountRole || mSortRole == LastActivityRole))
+    {
+        resort();
+    }
+}
+
+void TreeModel::patchTask(const Task &task, const QString &taskListId, std::initializer_list<QLatin1String> names)
+{
+    if (!mFlow)
+    {
+        return;
+    }
+
+    QNetworkRequest request(TaskList::taskUrl(taskListId, task.key()));
+    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+    const auto body = QJsonDocument(task.toJson(names)).toJson(QJsonDocument::Compact);
+
+    const auto send = [&body](QNetworkAccessManager & manager, const QNetworkRequest & request) {
+        return manager.sendCustomRequest(request, "PATCH", body);
+    };
+    ApiCall::send(*mFlow, request, mCancellation.token(), send).then([this, taskListId](const ApiResponse & response) {
+        if (!response.ok)
+        {
+            qWarning() << "Failed to save task:" << response.reply->url() << response.reply->errorString();
+            reloadTasks(taskListId);
+        }
+    });
+}
+
+void TreeModel::storeTasks(TaskList *taskList)
+{
+    QJsonArray tasks;
+    for (auto i: taskList->m_childItems)
+    {
+        tasks.append(static_cast<Task*>(i)->toJson());
+    }
+    mCache.store(taskList->getId(), taskList->title, tasks);
+}
+
+void TreeModel::storeCompleted(TaskList *taskList)
+{
+    QJsonArray tasks;
+    for (auto i: taskList->mCompleted->m_childItems)
+    {
+        tasks.append(static_cast<Task*>(i)->toJson());
+    }
+    mCompletedCache.store(taskList->getId(), taskList->title, tasks);
+}
+
+void TreeModel::resort()
+{
+    auto lessThan = [this](TreeItem * a, TreeItem * b) {
+        auto left = static_cast<TaskList*>(a);
+        auto right = static_cast<TaskList*>(b);
+        switch (mSortRole)
+        {
+        case OpenCountRole:
+            return left->openCount() < right->openCount();
+        case CompletedCountRole:
+            return left->completedCount() < right->completedCount();
+        case LastActivityRole:
+            return left->lastActivity() < right->lastActivity();
+        default:
+            return QString::localeAwareCompare(left->title, right->title) < 0;
+        }
+    };
+
+    emit layoutAboutToBeChanged({}, QAbstractItemModel::VerticalSortHint);
+    const auto before = persistentIndexList();
+    QVector<TreeItem*> items;
+    for (const auto & i: before)
+    {
+        items.append(static_cast<TreeItem*>(i.internalPointer()));
+    }
+
+    auto & children = rootItem->m_childItems;
+    if (mSortOrder == Qt::AscendingOrder)
+    {
+        std::stable_sort(children.begin(), children.end(), lessThan);
+    }
+    else
+    {
+        std::stable_sort(children.begin(), children.end(), [&lessThan](TreeItem * a, TreeItem * b) { return lessThan(b, a); });
+    }
+
+    QModelIndexList after;
+    for (int i = 0; i < before.size(); ++i)
+    {
+        after.append(createIndex(items[i]->row(), before[i].column(), items[i]));
+    }
+    changePersistentIndexList(before, after);
+    emit layoutChanged({}, QAbstractItemModel::VerticalSortHint);
+    schedulePublish();
+}
+
+void TreeModel::schedulePublish()
+{
+    // Coalesces a burst of edits into one version
+    if (std::exchange(mPublishPending, true))
+    {
+        return;
+    }
+    QMetaObject::invokeMethod(this, &TreeModel::publishSnapshot, Qt::QueuedConnection);
+}
+
+void TreeModel::publishSnapshot()
+{
+    mPublishPending = false;
+
+    auto snapshot = std::make_shared<TaskTreeSnapshot>();
+    snapshot->version = ++mSnapshotVersion;
+    snapshot->taskLists.reserve(rootItem->m_childItems.size());
+    for (auto i: rootItem->m_childItems)
+    {
+        snapshot->taskLists.append(static_cast<TaskList*>(i)->node());
+    }
+
+    // Counted from the snapshot, which already carries per-list totals
+    qint64 tasks = 0;
+    qint64 resident = 0;
+    for (const auto & i: qAsConst(snapshot->taskLists))
+    {
+        tasks += i->openCount + i->completedCount;
+        resident += i->tasks.size();
+    }
+    const qint64 counts[] = {snapshot->taskLists.size(), tasks, resident};
+    for (size_t i = 0; i < std::size(node_kinds); ++i)
+    {
+        Metrics::instance().setGauge(metric_model_nodes, Metrics::labels({{"model", mMetricsId}, {"kind", node_kinds[i]}}), counts[i]);
+    }
+
+    std::atomic_store(&mSnapshot, TaskTreeSnapshotPtr(std::move(snapshot)));
+    emit snapshotPublished(mSnapshotVersion);
+}
+
+void TreeModel::enforceMemoryBudget()
+{
+    while (mMemoryUsage > mMemoryBudget)
+    {
+        // Least recently used collapsed list that still holds its payload
+        TaskList * victim = nullptr;
+        for (auto i: rootItem->m_childItems)
+        {
+            auto taskList = static_cast<TaskList*>(i);
+            if (taskList->mExpanded || taskList->mEvicted
+                    || (taskList->m_childItems.isEmpty() && taskList->mCompleted->m_childItems.isEmpty()))
+            {
+                continue;
+            }
+            if (!victim || taskList->mLastUsed < victim->mLastUsed)
+            {
+                victim = taskList;
+            }
+        }
+        if (!victim)
+        {
+            break;
+        }
+        evict(victim);
+    }
+}
+
+void TreeModel::setupModelData(const QJsonArray &lines, TreeItem *parent)
+{
+    for (const auto & i: lines)
+    {
+        auto taskList = new TaskList(i.toObject(), parent);
+        parent->appendChild(taskList);
+        fetchTasks(taskList);
+    }
+}
+
+void TreeModel::fetchTasks(TaskList *taskList)
+{
+    // Without a flow the model is only fed through setTasks()
+    if (!mFlow)
+    {
+        return;
+    }
+
+    // The newest payload wins, so a download still running is dropped
+    taskList->mLoad.reset();
+    taskList->mLoading = true;
+    auto load = std::make_shared<TaskLoad>();
+    load->taskList = taskList;
+    load->cache = mCache.writer(taskList->getId(), taskList->title);
+    fetchTasksPage(load, {});
+}
+
+void TreeModel::fetchTasksPage(std::shared_ptr<TaskLoad> load, const QString &pageToken)
+{
+    auto taskList = load->taskList;
+    auto url = TaskList::tasksUrl(taskList->getId());
+    if (!pageToken.isEmpty())
+    {
+        QUrlQuery query(url);
+        query.addQueryItem("pageToken", pageToken);
+        url.setQuery(query);
+    }
+
+    // Scoped to the list's load: after the list is removed or a newer load
+    // started, the transfer is aborted and none of this runs
+    ApiCall::get(*mFlow, url, taskList->mLoad.token())
+            .onItem([load, taskList](const QByteArray & item) {
+        // Items become Tasks as soon as their closing brace arrives
+        load->cache->append(item);
+        load->tasks.append(new Task(QJsonDocument::fromJson(item).object(), taskList));
+    }).then([this, load, taskList](const ApiResponse & response) {
+        if (load->etag.isEmpty())
+        {
+            load->etag = response.reply->rawHeader("ETag");
+        }
+        if (!response.ok)
+        {
+            taskList->mLoading = false;
+            qCritical() << "Google error:" << response.reply->errorString() << response.reply->error();
+            return;
+        }
+
+        if (const auto next = response.field("nextPageToken"); !next.isEmpty())
+        {
+            fetchTasksPage(load, next);
+            return;
+        }
+
+        taskList->mLoading = false;
+        load->cache->commit();
+        adoptTasks(taskList, std::exchange(load->tasks, {}));
+        emit tasksLoaded(taskList->getId(), load->etag);
+    });
+}
+
+void TreeModel::fetchCompleted(CompletedSection *section)
+{
+    if (!mFlow)
+    {
+        section->mStage = CompletedSection::Stage::Done;
+        return;
+    }
+
+    if (section->mStage == CompletedSection::Stage::Recent && section->mRecentMin.isNull())
+    {
+        section->mRecentMin = QDateTime::currentDateTimeUtc().addDays(-recent_completed_days);
+    }
+
+    auto url = TaskList::tasksUrl(section->taskList()->getId());
+    QUrlQuery query;
+    query.addQueryItem("maxResults", "100");
+    query.addQueryItem("showCompleted", "true");
+    // Tasks completed in Google's own apps are hidden right away
+    query.addQueryItem("showHidden", "true");
+    query.addQueryItem(section->mStage == CompletedSection::Stage::Recent ? "completedMin" : "completedMax",
+                       formatRfc3339(section->mRecentMin));
+    if (!section->mPageToken.isEmpty())
+    {
+        query.addQueryItem("pageToken", section->mPageToken);
+    }
+    url.setQuery(query);
+
+    section->mLoading = true;
+    auto load = std::make_shared<TaskLoad>();
+    load->taskList = section->taskList();
+    // Eviction cancels the page the section was loading
+    ApiCall::get(*mFlow, url, section->mLoad.token())
+            .onItem([load, section](const QByteArray & item) {
+        load->tasks.append(new Task(QJsonDocument::fromJson(item).object(), section));
+    }).then([this, load, section](const ApiResponse & response) {
+        section->mLoading = false;
+        if (!response.ok)
+        {
+            qCritical() << "Google error:" << response.reply->errorString() << response.reply->error();
+            return;
+        }
+
+        section->mPageToken = response.field("nextPageToken");
+        if (section->mPageToken.isEmpty())
+        {
+            section->mStage = section->mStage == CompletedSection::Stage::Recent
+                    ? CompletedSection::Stage::Older
+                    : CompletedSection::Stage::Done;
+        }
+        const bool fresh = adoptCompleted(load->taskList, std::exchange(load->tasks, {}));
+        // Expanding loads the whole week. Older pages only when the view
+        // asked and got nothing new to scroll to, so it would not ask again.
+        if (section->mWanted && (section->mStage == CompletedSection::Stage::Recent
+                                 || (!fresh && section->mStage != CompletedSection::Stage::Done)))
+        {
+            fetchCompleted(section);
+            return;
+        }
+        enforceMemoryBudget();
+    });
+}
+
+void TreeModel::fetchCompletedSince(CompletedSection *section, const QDateTime &since, const QString &pageToken)
+{
+    if (!mFlow)
+    {
+        return;
+    }
+
+    auto url = TaskList::tasksUrl(section->taskList()->getId());
+    QUrlQuery query;
+    query.addQueryItem("maxResults", "100");
+    query.addQueryItem("showCompleted", "true");
+    query.addQueryItem("showHidden", "true");
+    query.addQueryItem("completedMin", formatRfc3339(since));
+    if (!pageToken.isEmpty())
+    {
+        query.addQueryItem("pageToken", pageToken);
+    }
+    url.setQuery(query);
+
+    auto load = std::make_shared<TaskLoad>();
+    load->taskList = section->taskList();
+    ApiCall::get(*mFlow, url, section->mLoad.token())
+            .onItem([load, section](const QByteArray & item) {
+        load->tasks.append(new Task(QJsonDocument::fromJson(item).object(), section));
+    }).then([this, load, section, since](const ApiResponse & response) {
+        if (!response.ok)
+        {
+            qCritical() << "Google error:" << response.reply->errorString() << response.reply->error();
+            return;
+        }
+
+        adoptCompleted(load->taskList, std::exchange(load->tasks, {}));
+        if (const auto next = response.field("nextPageToken"); !next.isEmpty())
+        {
+            fetchCompletedSince(section, since, next);
+            return;
+        }
+        enforceMemoryBudget();
+    });
+}
+
+bool TreeModel::adoptCompleted(TaskList *taskList, const QVector<Task*> &tasks)
+{
+    auto section = taskList->mCompleted.get();
+
+    // Pages of different windows can overlap, and a task completed here stays
+    // among the open ones until the next refresh of the list
+    QSet<QString> known;
+    for (auto i: taskList->m_childItems + section->m_childItems)
+    {
+        known.insert(i->key());
+    }
+    QVector<Task*> fresh;
+    for (auto task: tasks)
+    {
+        if (task->getStatus() == "completed" && !known.contains(task->key()))
+        {
+            known.insert(task->key());
+            fresh.append(task);
+        }
+        else
+        {
+            delete task;
+        }
+    }
+
+    const auto sectionIndex = createIndex(section->row(), 0, section);
+    if (!fresh.isEmpty())
+    {
+        const int first = section->m_childItems.size();
+        beginInsertRows(sectionIndex, first, first + fresh.size() - 1);
+        for (auto task: fresh)
+        {
+            section->m_childItems.append(task);
+        }
+        endInsertRows();
+
+        for (auto task: fresh)
+        {
+            taskList->countTask(*task, 1);
+            mIndex.update(*task, taskList->getId());
+            taskList->mFootprint += task->footprint();
+            mMemoryUsage += task->footprint();
+        }
+        storeCompleted(taskList);
+        emit taskIndexChanged();
     }
+    // The "+" of the list and the section goes away with the last page
+    aggregatesChanged(taskList);
+    emit dataChanged(sectionIndex, sectionIndex, {Qt::DisplayRole});
+    return !fresh.isEmpty();
 }
@@ -8,9 +8,16 @@
 #include <QDateTime>
 #include <QUrl>
 #include <QVector>
+#include <QSet>
 #include <QAbstractItemModel>
 #include <QtNetworkAuth/QOAuth2AuthorizationCodeFlow>
 
+#include "cancellation.h"
+#include "jsonfields.h"
+#include "taskcache.h"
+#include "taskindex.h"
+#include "tasksnapshot.h"
+
 class TreeItem
 {
 public:
@@ -27,6 +34,11 @@ public:
     virtual int row() const;
     virtual TreeItem *parentItem();
 
+    // Identity used to match items against fresh server data
+    virtual QString key() const;
+    // Takes over the payload of a fresh copy; returns false when nothing changed
+    virtual bool updateFrom(const TreeItem & other);
+
     QVector<TreeItem*> m_childItems;
     QVector<QVariant> m_itemData;
     TreeItem *m_parentItem;
@@ -35,6 +47,7 @@ public:
 
 
 class TaskList;
+class CompletedSection;
 
 class Task: public TreeItem
 {
@@ -66,62 +79,131 @@ public:
         return column ? QVariant{} : mTitle;
     }
 
-    virtual bool setData(const QVariant & value, int role)
-    {
-        switch (role)
-        {
-        case Qt::CheckStateRole:
-        {
-            status = value.toBool() ? "completed" : "needsAction";
-            break;
-        }
-        case Qt::EditRole:
-        {
-            mTitle = value.toString();
-            break;
-        }
-        default:
-            return false;
-        }
-        return true;
-    }
-
-    virtual int row() const
-    {
-        if (m_parentItem)
-            return m_parentItem->m_childItems.indexOf(const_cast<Task*>(this));
+    virtual bool setData(const QVariant & value, int role);
 
-        return 0;
-    }
     virtual TreeItem *parentItem()
     {
         return mParent;
     }
 
+    // Owning list, also for tasks below its completed section
+    TaskList *taskList() const;
+
     inline QString title() const
     {
         return mTitle;
     }
 
     QString getStatus() const;
+    QDateTime getUpdated() const;
+    QDateTime getDue() const;
+    QDateTime getCompleted() const;
+    QString getNotes() const;
+    QString getPosition() const;
+
+    // Puts the task under taskList; TreeModel moves the row
+    void moveTo(TaskList * taskList);
+    // Puts a task completed here under its list's completed section
+    void moveTo(CompletedSection * section);
+
+    virtual QString key() const;
+    virtual bool updateFrom(const TreeItem & other);
+
+    // Approximate heap cost, used for the model's memory budget
+    qint64 footprint() const;
+
+    // Published form of this task, rebuilt only after it changed
+    std::shared_ptr<const TaskNode> node() const;
+
+    // Resource representation; with names, only those members (PATCH bodies)
+    QJsonObject toJson(std::initializer_list<QLatin1String> names = {}) const;
 
 private:
+    static constexpr auto jsonFields()
+    {
+        return std::make_tuple(
+            jsonField("kind", &Task::kind),
+            jsonField("id", &Task::id),
+            jsonField("etag", &Task::etag),
+            jsonField("title", &Task::mTitle),
+            jsonField("updated", &Task::updated),
+            jsonField("selfLink", &Task::selfLink),
+            jsonField("position", &Task::position),
+            jsonField("status", &Task::status),
+            jsonField("due", &Task::due),
+            jsonField("completed", &Task::completed),
+            jsonField("notes", &Task::notes));
+    }
+
     QString kind;
     QString id;
     QString etag;
     QString mTitle;
     QDateTime updated;
     QUrl selfLink;
-    unsigned long position;
+    // Google's sort key among siblings, compared as a string. Locally the row
+    // in the parent's children is the order; a move takes the server's key
+    // with the read-back.
+    QString position;
     QString status;
+    QDateTime due;
+    QDateTime completed;
+    QString notes;
 
     TreeItem * mParent;
+
+    mutable std::shared_ptr<const TaskNode> mNode;
+
+    void invalidateNode();
+};
+
+// Completed tasks of a list, shown as the list's last row. Nothing is
+// downloaded until the row is expanded; then the last week comes at once and
+// older completions one page per fetchMore(). Counts and the recently
+// completed view cover what was loaded.
+class CompletedSection: public TreeItem
+{
+public:
+    explicit CompletedSection(TaskList *taskList);
+
+    virtual QVariant data(int column) const;
+    virtual int row() const;
+
+    TaskList *taskList() const;
+    // Completions are left on the server, to be loaded page by page
+    bool hasMore() const;
+
+private:
+    friend class TreeModel;
+
+    enum class Stage
+    {
+        Recent,
+        Older,
+        Done
+    };
+
+    // Forgets what was loaded and cancels the page being loaded
+    void reset();
+
+    Stage     mStage = Stage::Recent;
+    QDateTime mRecentMin;
+    QString   mPageToken;
+    bool      mLoading = false;
+    // Expanded by the view; nothing is loaded before
+    bool      mWanted = false;
+
+    CancellationSource mLoad;
 };
 
 class TaskList: public TreeItem
 {
 public:
-    TaskList(const QJsonObject & taskListObject, QOAuth2AuthorizationCodeFlow * flow, TreeItem *parent);
+    TaskList(const QJsonObject & taskListObject, TreeItem *parent);
+
+    static QUrl tasksUrl(const QString & taskListId);
+    static QUrl taskUrl(const QString & taskListId, const QString & taskId);
+    static QUrl moveUrl(const QString & taskListId, const QString & taskId);
 
     virtual void appendChild(TreeItem *child);
 
@@ -143,9 +225,42 @@ public:
         }
         return true;
     }
-    virtual int row() const;
     virtual TreeItem *parentItem();
+
+    QString getId() const;
+
+    virtual QString key() const;
+    virtual bool updateFrom(const TreeItem & other);
+
+    // Aggregates are kept up to date by every insert, removal and status
+    // change, so reading them never walks the children
+    int openCount() const;
+    int completedCount() const;
+    QDateTime lastActivity() const;
+
+    void countTask(const Task & task, int delta);
+    void onTaskToggled(const Task & task);
+    void resetOpenCount();
+    void resetCompletedCount();
+
+    // Published form of this list; shares the nodes of unchanged tasks
+    std::shared_ptr<const TaskListNode> node() const;
+    void invalidateNode();
+
 private:
+    friend class TreeModel;
+
+    static constexpr auto jsonFields()
+    {
+        return std::make_tuple(
+            jsonField("etag", &TaskList::etag),
+            jsonField("id", &TaskList::id),
+            jsonField("kind", &TaskList::kind),
+            jsonField("selfLink", &TaskList::selfLink),
+            jsonField("title", &TaskList::title),
+            jsonField("updated", &TaskList::updated));
+    }
+
     QString   etag;
     QString   id;
     QString   kind;
@@ -154,7 +269,32 @@ private:
     QDateTime updated;
 
     TreeItem * mParent;
-    QVector<TreeItem*> m_childItems;
+
+    // Last row, after the open tasks in m_childItems; hidden while evicted
+    std::unique_ptr<CompletedSection> mCompleted;
+
+    // Scope of the download of the open tasks, cancelled by a newer one and
+    // by the list's removal
+    CancellationSource mLoad;
+    // That download is running; fetchMore() must not restart it
+    bool mLoading = false;
+
+    // Residency bookkeeping maintained by TreeModel. An evicted list has no
+    // children in memory and is rehydrated by fetchMore().
+    bool    mEvicted = false;
+    bool    mExpanded = false;
+    quint64 mLastUsed = 0;
+    qint64  mFootprint = 0;
+
+    // When the open tasks were last reconciled; a task missing from the
+    // next payload was completed or deleted after that
+    QDateTime mSyncedAt;
+
+    int       mOpenCount = 0;
+    int       mCompletedCount = 0;
+    QDateTime mLastActivity;
+
+    mutable std::shared_ptr<const TaskListNode> mNode;
 };
 
 class TreeModel : public QAbstractItemModel
@@ -162,6 +302,13 @@ class TreeModel : public QAbstractItemModel
     Q_OBJECT
 
 public:
+    enum Roles
+    {
+        OpenCountRole = Qt::UserRole + 1,
+        CompletedCountRole,
+        LastActivityRole
+    };
+
     explicit TreeModel(const QJsonArray &data, std::shared_ptr<QOAuth2AuthorizationCodeFlow> flow, QObject *parent = nullptr);
     ~TreeModel();
 
@@ -175,11 +322,121 @@ public:
     QModelIndex parent(const QModelIndex &index) const override;
     int rowCount(const QModelIndex &parent = QModelIndex()) const override;
     int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
+    bool hasChildren(const QModelIndex &parent = QModelIndex()) const override;
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+
+    // Open tasks can be dragged within and between resident lists
+    Qt::DropActions supportedDropActions() const override;
+    QStringList mimeTypes() const override;
+    QMimeData *mimeData(const QModelIndexList &indexes) const override;
+    bool canDropMimeData(const QMimeData *data, Qt::DropAction action, int row, int column,
+                         const QModelIndex &parent) const override;
+    bool dropMimeData(const QMimeData *data, Qt::DropAction action, int row, int column,
+                      const QModelIndex &parent) override;
+
+    // Role task lists are ordered by in sort(); DisplayRole sorts by title
+    void setSortRole(int role);
+
+    void setMemoryBudget(qint64 bytes);
+    qint64 memoryUsage() const;
+
+    const TaskIndex & taskIndex() const;
+
+    // Latest published snapshot. Safe to call from any thread, O(1); the
+    // result can be traversed without locks while the model keeps changing.
+    TaskTreeSnapshotPtr snapshot() const;
+
+    TaskList *findTaskList(const QString & taskListId) const;
+    void setTaskLists(const QJsonArray & taskLists);
+    void setTasks(const QString & taskListId, const QJsonArray & tasks);
+    // Raw item objects as streamed by a poll, written to the cache verbatim
+    void setTasks(const QString & taskListId, const QVector<QByteArray> & items);
+    void reloadTasks(const QString & taskListId);
+
+public slots:
+    void onExpanded(const QModelIndex &index);
+    void onCollapsed(const QModelIndex &index);
+
+signals:
+    // Emitted with the ETag of the tasks collection after each initial fetch
+    void tasksLoaded(const QString & taskListId, const QByteArray & etag);
+    void taskIndexChanged();
+    void snapshotPublished(quint64 version);
 
 private:
-    void setupModelData(const QJsonArray &lines, QOAuth2AuthorizationCodeFlow *flow, TreeItem *parent);
+    void setupModelData(const QJsonArray &lines, TreeItem *parent);
+    struct TaskLoad;
+    struct MoveCheck;
+
+    void fetchTasks(TaskList * taskList);
+    void fetchTasksPage(std::shared_ptr<TaskLoad> load, const QString & pageToken);
+    void adoptTasks(TaskList * taskList, const QVector<Task*> & tasks);
+    void reconcileTasks(TaskList * taskList, const QVector<Task*> & tasks);
+    void reconcileChildren(TreeItem * parentItem, const QVector<TreeItem*> & fresh,
+                           QVector<TreeItem*> & adopted, QVector<TreeItem*> & updated,
+                           QVector<TreeItem*> & removed);
+    void evict(TaskList * taskList);
+    void enforceMemoryBudget();
+    void aggregatesChanged(TaskList * taskList);
+    void fetchCompleted(CompletedSection * section);
+    // Every completion since a point in time, all pages, without moving the
+    // section's own paging; finds tasks completed on another device
+    void fetchCompletedSince(CompletedSection * section, const QDateTime & since, const QString & pageToken);
+    // Adds the tasks the section does not have yet, true if there were any
+    bool adoptCompleted(TaskList * taskList, const QVector<Task*> & tasks);
+    // Moves the rows at once, then queues one server move per task
+    void moveTasks(const QVector<Task*> & tasks, TaskList * destination, int row);
+    void sendMoves();
+    // Reads the touched lists back once every move was answered, re-sends
+    // the moves of tasks the server placed elsewhere, and adopts the lists
+    // when they match the local order
+    void verifyMoves();
+    void fetchMoveCheck(std::shared_ptr<MoveCheck> check, const QString & taskListId, const QString & pageToken);
+    void checkMoves(const MoveCheck & check);
+    // Sends the given members of an edited task; the server copy wins on failure
+    void patchTask(const Task & task, const QString & taskListId, std::initializer_list<QLatin1String> names);
+    // Rewrite the list's caches from the model after a local change, so an
+    // evicted list and the offline export see it before the next refresh
+    void storeTasks(TaskList * taskList);
+    void storeCompleted(TaskList * taskList);
+    // Reads an evicted list's section back from that cache and counts it anew
+    void restoreCompleted(TaskList * taskList);
+    void resort();
+    void schedulePublish();
+    void publishSnapshot();
 
     TreeItem *rootItem;
+    std::shared_ptr<QOAuth2AuthorizationCodeFlow> mFlow;
+    // Scope of the model's own calls (edits, moves); lists have their own
+    CancellationSource mCancellation;
+
+    TaskCache mCache;
+    TaskCache mCompletedCache{TaskCache::Contents::Completed};
+    TaskIndex mIndex;
+    qint64 mMemoryBudget;
+    qint64 mMemoryUsage = 0;
+    quint64 mUseClock = 0;
+
+    int mSortRole = Qt::DisplayRole;
+    Qt::SortOrder mSortOrder = Qt::AscendingOrder;
+    bool mSorted = false;
+
+    TaskTreeSnapshotPtr mSnapshot;
+    quint64 mSnapshotVersion = 0;
+    bool mPublishPending = false;
+
+    // Move calls not sent yet, as batch request lines, and the lists they
+    // touch; those lists ignore fetched payloads until the moves are
+    // verified. Calls within a batch may run in any order, so the calls are
+    // grouped in waves: a wave goes out once the one before it was answered.
+    QVector<QVector<QByteArray>> mMoveQueue;
+    QSet<QString> mMoveLists;
+    bool mMoveInFlight = false;
+    int mMoveRound = 0;
+
+    QByteArray mMetricsId;
 };
 
 #endif // TASKLIST_H
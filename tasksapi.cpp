@@ -0,0 +1,87 @@
+#include "tasksapi.h"
+
+#include <QHttpMultiPart>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QSslConfiguration>
+#include <QUrlQuery>
+
+ApiNetworkAccessManager::ApiNetworkAccessManager(QObject *parent)
+    : ApiNetworkAccessManager(api_host, api_port, parent)
+{
+
+}
+
+ApiNetworkAccessManager::ApiNetworkAccessManager(const QString &host, quint16 port, QObject *parent)
+    : MeteredNetworkAccessManager(parent)
+    , mHost(host)
+    , mPort(port)
+    , mSslConfiguration(QSslConfiguration::defaultConfiguration())
+{
+    mSslConfiguration.setAllowedNextProtocols({QSslConfiguration::ALPNProtocolHTTP2,
+                                               QSslConfiguration::NextProtocolHttp1_1});
+}
+
+void ApiNetworkAccessManager::warmUp()
+{
+    // Same configuration as the requests, or they would not reuse the connection
+    connectToHostEncrypted(mHost, mPort, mSslConfiguration);
+}
+
+QNetworkReply *ApiNetworkAccessManager::createRequest(Operation op, const QNetworkRequest &request, QIODevice *outgoingData)
+{
+    if (request.url().host() != mHost)
+    {
+        return MeteredNetworkAccessManager::createRequest(op, request, outgoingData);
+    }
+
+    QNetworkRequest apiRequest(request);
+    if (!request.url().path().startsWith("/batch/"))
+    {
+        // One line per item: streamed items can be stored and exported as
+        // they are, and the bodies shrink by their indentation
+        auto url = request.url();
+        QUrlQuery query(url);
+        query.removeAllQueryItems("prettyPrint");
+        query.addQueryItem("prettyPrint", "false");
+        url.setQuery(query);
+        apiRequest.setUrl(url);
+    }
+    apiRequest.setAttribute(QNetworkRequest::Http2AllowedAttribute, true);
+    apiRequest.setSslConfiguration(mSslConfiguration);
+    return MeteredNetworkAccessManager::createRequest(op, apiRequest, outgoingData);
+}
+
+QHttpMultiPart *batchBody(const QVector<QByteArray> &calls)
+{
+    auto body = new QHttpMultiPart(QHttpMultiPart::MixedType);
+    for (int i = 0; i < calls.size(); ++i)
+    {
+        QHttpPart part;
+        part.setRawHeader("Content-Type", "application/http");
+        part.setRawHeader("Content-ID", "<" + QByteArray::number(i) + ">");
+        part.setBody(calls[i] + "\r\n\r\n");
+        body->append(part);
+    }
+    return body;
+}
+
+QVector<int> batchStatuses(QNetworkReply *reply)
+{
+    if (!reply->header(QNetworkRequest::ContentTypeHeader).toString().startsWith("multipart/mixed"))
+    {
+        return {};
+    }
+
+    // Each part holds a whole HTTP response; in the JSON bodies no line
+    // starts with a status line
+    QVector<int> statuses;
+    for (const auto & line: reply->readAll().split('\n'))
+    {
+        if (line.startsWith("HTTP/"))
+        {
+            statuses.append(line.mid(line.indexOf(' ') + 1, 3).toInt());
+        }
+    }
+    return statuses;
+}
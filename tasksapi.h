@@ -0,0 +1,54 @@
+#ifndef TASKSAPI_H
+#define TASKSAPI_H
+
+#include <QByteArray>
+#include <QSslConfiguration>
+#include <QString>
+#include <QVector>
+
+#include "metrics.h"
+
+// Every Tasks API call goes to this one origin so that lists, tasks and
+// polls share a single TLS connection.
+constexpr const char * api_host = "tasks.googleapis.com";
+constexpr quint16 api_port = 443;
+constexpr const char * api_base_url = "https://tasks.googleapis.com/tasks/v1";
+constexpr const char * task_lists_url = "https://tasks.googleapis.com/tasks/v1/users/@me/lists";
+// Takes many API calls as the parts of one multipart/mixed request and
+// answers them in one multipart response
+constexpr const char * api_batch_url = "https://tasks.googleapis.com/batch/tasks/v1";
+
+class QHttpMultiPart;
+class QNetworkReply;
+
+// One part per call; a call is its request line, "POST /tasks/v1/... HTTP/1.1"
+QHttpMultiPart *batchBody(const QVector<QByteArray> & calls);
+// HTTP status of every call answered in a batch response
+QVector<int> batchStatuses(QNetworkReply * reply);
+
+// Network manager of the OAuth flow. Requests to the API host are allowed
+// to negotiate HTTP/2 and all use the same TLS configuration, so they are
+// multiplexed over the connection warmUp() opened instead of each paying for
+// its own handshake. They also ask for compact JSON (prettyPrint=false).
+class ApiNetworkAccessManager : public MeteredNetworkAccessManager
+{
+public:
+    explicit ApiNetworkAccessManager(QObject *parent = nullptr);
+    // Treats host:port as the API origin instead, e.g. a local stand-in
+    ApiNetworkAccessManager(const QString & host, quint16 port, QObject *parent = nullptr);
+
+    // Resolves, connects and completes the TLS handshake ahead of the first
+    // request; returns immediately
+    void warmUp();
+
+protected:
+    QNetworkReply *createRequest(Operation op, const QNetworkRequest &request,
+                                 QIODevice *outgoingData = nullptr) override;
+
+private:
+    QString mHost;
+    quint16 mPort;
+    QSslConfiguration mSslConfiguration;
+};
+
+#endif // TASKSAPI_H
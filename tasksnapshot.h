@@ -0,0 +1,50 @@
+#ifndef TASKSNAPSHOT_H
+#define TASKSNAPSHOT_H
+
+#include <memory>
+
+#include <QDateTime>
+#include <QString>
+#include <QVector>
+
+// Immutable view of the task tree for readers off the GUI thread. Nodes are
+// never modified once published; a new version copies only the path from
+// the root to what changed and shares every other node with its
+// predecessor. Holding a snapshot pins its version, nothing else.
+
+struct TaskNode
+{
+    QString   id;
+    QString   etag;
+    QString   title;
+    QString   status;
+    QString   notes;
+    QDateTime updated;
+    QDateTime due;
+    QDateTime completed;
+};
+
+struct TaskListNode
+{
+    QString   id;
+    QString   etag;
+    QString   title;
+    QDateTime updated;
+
+    int openCount = 0;
+    int completedCount = 0;
+    // Evicted lists publish their counts but no task nodes
+    bool evicted = false;
+
+    QVector<std::shared_ptr<const TaskNode>> tasks;
+};
+
+struct TaskTreeSnapshot
+{
+    quint64 version = 0;
+    QVector<std::shared_ptr<const TaskListNode>> taskLists;
+};
+
+using TaskTreeSnapshotPtr = std::shared_ptr<const TaskTreeSnapshot>;
+
+#endif // TASKSNAPSHOT_H